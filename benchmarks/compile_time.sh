@@ -0,0 +1,41 @@
+#!/bin/sh
+# Times how long handler lookup takes to compile: the C++14 path (marker
+# bases, std::is_base_of), built as C++14 and as C++20 to separate the cost
+# of the newer standard headers; the C++20 path with the same handlers; and
+# the C++20 path with marker-free handlers matched by the concept check
+# alone.
+# Each configuration is a syntax-only compile of
+# tests/code_size/many_requests.cc, best of three.
+#
+# usage: compile_time.sh [compiler] [request counts...]
+
+set -e
+cxx="${1:-c++}"
+[ $# -gt 0 ] && shift
+counts="${*:-100 500 1000}"
+source="$(dirname "$0")/../tests/code_size/many_requests.cc"
+
+now_ms() {
+  echo $(( $(date +%s%N) / 1000000 ))
+}
+
+best_of_three() {
+  best=""
+  for run in 1 2 3; do
+    start=$(now_ms)
+    "$cxx" -fsyntax-only "$@" "$source"
+    elapsed=$(( $(now_ms) - start ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then best=$elapsed; fi
+  done
+  echo "$best"
+}
+
+printf "%9s %12s %18s %12s %16s\n" \
+  requests "c++14 ms" "c++20 c++14-path" "c++20 ms" "c++20 concept ms"
+for n in $counts; do
+  printf "%9d %12d %18d %12d %16d\n" "$n" \
+    "$(best_of_three -std=c++14 -DREQUESTS="$n")" \
+    "$(best_of_three -std=c++20 -DREQUESTS="$n" -DHOLDEN_MEDIATOR_CONCEPTS=0)" \
+    "$(best_of_three -std=c++20 -DREQUESTS="$n")" \
+    "$(best_of_three -std=c++20 -DREQUESTS="$n" -DNO_MARKERS)"
+done
@@ -0,0 +1,118 @@
+// Measures the round-trip latency of a queued send for each dispatcher wait
+// policy: the time from queueing a request until the caller observes that
+// its handler ran. Then compares the cost of the two completion paths,
+// futures (`send_async`) and inline continuations (`send_then`), over a
+// stream of pipelined sends.
+//
+// usage: dispatcher_latency [round_trips] [worker_cpu]
+//
+// For meaningful busy-poll numbers, boot with e.g. `isolcpus=3 nohz_full=3`
+// and pass the isolated core as `worker_cpu`; the caller should run on a
+// different core (`taskset -c 2 ./dispatcher_latency 100000 3`).
+
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+// The caller spins on `done` rather than blocking on the future, so the
+// measurement isolates how quickly the worker notices the request.
+struct Ping {
+  using response_type = void;
+  std::atomic<bool>* done;
+};
+
+struct Echo {
+  using response_type = int;
+  int value;
+};
+
+struct Ponger
+  : holden::request_handler<Ping>
+  , holden::request_handler<Echo> {
+  void handle(const Ping& p) { p.done->store(true, std::memory_order_release); }
+  int handle(const Echo& e) { return e.value; }
+};
+
+template <typename WaitPolicy>
+void measure(const char* name, WaitPolicy policy, int round_trips, int cpu) {
+  Ponger ponger;
+  holden::mediator<Ponger&> m(ponger);
+  holden::dispatcher<decltype(m), WaitPolicy> d(m, policy, cpu);
+
+  std::vector<double> samples;
+  samples.reserve(static_cast<std::size_t>(round_trips));
+  for (int i = 0; i < round_trips; ++i) {
+    std::atomic<bool> done{false};
+    const auto start = clock_type::now();
+    d.send_async(Ping{&done});
+    while (!done.load(std::memory_order_acquire)) holden::detail::cpu_relax();
+    const auto end = clock_type::now();
+    samples.push_back(
+        std::chrono::duration<double, std::nano>(end - start).count());
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto pct = [&](double p) {
+    return samples[static_cast<std::size_t>(p * double(samples.size() - 1))];
+  };
+  std::printf("%-16s p50 %9.0f ns   p99 %9.0f ns   p99.9 %9.0f ns\n",
+              name, pct(0.5), pct(0.99), pct(0.999));
+}
+
+template <typename Sends>
+void measure_completions(const char* name, int sends, Sends&& run) {
+  const auto start = clock_type::now();
+  run(sends);
+  const std::chrono::duration<double, std::nano> elapsed =
+      clock_type::now() - start;
+  std::printf("%-16s %9.0f ns per completed send\n", name,
+              elapsed.count() / sends);
+}
+
+void compare_completion_paths(int sends) {
+  Ponger ponger;
+  holden::mediator<Ponger&> m(ponger);
+  holden::dispatcher<decltype(m), holden::spin_then_park_wait> d(m);
+
+  measure_completions("future", sends, [&](int n) {
+    std::vector<std::future<int>> futures;
+    futures.reserve(static_cast<std::size_t>(n));
+    for (int i = 0; i < n; ++i) futures.push_back(d.send_async(Echo{i}));
+    for (auto& f : futures) f.get();
+  });
+
+  measure_completions("send_then", sends, [&](int n) {
+    std::atomic<int> completed{0};
+    for (int i = 0; i < n; ++i) {
+      d.send_then(Echo{i}, [&completed](holden::result<int>) {
+        completed.fetch_add(1, std::memory_order_release);
+      });
+    }
+    while (completed.load(std::memory_order_acquire) < n)
+      std::this_thread::yield();
+  });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int round_trips = argc > 1 ? std::atoi(argv[1]) : 10000;
+  const int cpu = argc > 2 ? std::atoi(argv[2]) : -1;
+
+  measure("park (futex)", holden::park_wait{}, round_trips, cpu);
+  measure("spin-then-park", holden::spin_then_park_wait{}, round_trips, cpu);
+  measure("busy-poll", holden::busy_poll_wait{}, round_trips, cpu);
+  compare_completion_paths(round_trips * 10);
+  return 0;
+}
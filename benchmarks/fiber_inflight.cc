@@ -0,0 +1,65 @@
+// Keeps 100k requests in flight at once on one thread: every handler runs on
+// its own fiber and parks in the middle of handling, as if waiting on I/O,
+// while one client fiber has sent all of them and waits for each response.
+//
+// usage: fiber_inflight [in_flight] [stack_kib]
+
+#include "../include/cpp_mediator/fiber.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+struct Lookup {
+  using response_type = long;
+  long key;
+};
+
+struct Store : holden::request_handler<Lookup> {
+  long in_flight = 0;
+  long peak = 0;
+
+  long handle(const Lookup& r) {
+    if (++in_flight > peak) peak = in_flight;
+    holden::fiber_scheduler::current()->yield();
+    --in_flight;
+    return r.key * 2;
+  }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const long requests = argc > 1 ? std::atol(argv[1]) : 100000;
+  const std::size_t stack_kib = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                                         : 16;
+
+  Store store;
+  auto m = holden::make_mediator(store);
+  holden::fiber_scheduler fibers(stack_kib * 1024);
+
+  long sum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  fibers.spawn([&] {
+    std::vector<holden::fiber_future<long>> pending;
+    pending.reserve(static_cast<std::size_t>(requests));
+    for (long i = 0; i < requests; ++i)
+      pending.push_back(fibers.send_async(m, Lookup{i}));
+    for (auto& f : pending) sum += f.get();
+  });
+  fibers.run();
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (sum != requests * (requests - 1)) return 1;
+  std::printf("%ld requests, peak %ld in flight on %zu fibers "
+              "(%zu KiB stacks)\n",
+              requests, store.peak, fibers.fiber_count(), stack_kib);
+  std::printf("total %.3f s, %.0f ns per request\n", elapsed.count(),
+              elapsed.count() * 1e9 / double(requests));
+  return 0;
+}
@@ -0,0 +1,69 @@
+// Compares the cost of a send through the concrete mediator, which is
+// resolved at compile time and inlined, with one through a
+// `mediator_ref`, which is one indirect call through its table.
+//
+// usage: mediator_ref_dispatch [sends]
+
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/mediator_ref.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct Add : holden::request<long> {
+  long value;
+  explicit Add(long v) : value(v) {}
+};
+
+struct Reset : holden::request<void> {};
+
+class Accumulator
+  : holden::request_handler<Add>
+  , holden::request_handler<Reset> {
+  long total_ = 0;
+
+ public:
+  long handle(const Add& a) { return total_ += a.value; }
+  void handle(const Reset&) { total_ = 0; }
+};
+
+// Hides `p`'s value from the optimiser, so the ref's table pointer is
+// loaded and called rather than constant-folded into a direct call.
+template <typename T>
+void opaque(T& p) {
+  asm volatile("" : : "g"(&p) : "memory");
+}
+
+template <typename Sender>
+void measure(const char* name, Sender& sender, long sends) {
+  long sink = 0;
+  const auto start = clock_type::now();
+  for (long i = 0; i < sends; ++i) {
+    opaque(sender);
+    sink += sender.send(Add{i});
+  }
+  const std::chrono::duration<double, std::nano> elapsed =
+      clock_type::now() - start;
+  std::printf("%-14s %6.2f ns per send (%ld)\n", name,
+              elapsed.count() / double(sends), sink);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const long sends = argc > 1 ? std::atol(argv[1]) : 100000000;
+
+  Accumulator acc;
+  auto m = holden::make_mediator(acc);
+  holden::mediator_ref<Add, Reset> ref(m);
+
+  measure("mediator", m, sends);
+  ref.send(Reset{});
+  measure("mediator_ref", ref, sends);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#!/bin/sh
+# Compares the build time of many small translation units that each use a
+# mediator, once including mediator.hpp and once importing the
+# `cpp_mediator` module (built once up front, and counted). Each TU
+# declares its own requests and handler and sends each request once.
+#
+# usage: module_build.sh [translation_units] [compiler]
+
+set -e
+tus="${1:-200}"
+cxx="${2:-g++}"
+root="$(cd "$(dirname "$0")/.." && pwd)"
+work="$(mktemp -d)"
+trap 'rm -rf "$work"' EXIT
+cd "$work"
+
+now_ms() {
+  echo $(( $(date +%s%N) / 1000000 ))
+}
+
+generate() {  # generate <index> <preamble>
+  cat <<TU
+$2
+
+namespace tu$1 {
+template <int I> struct Req : holden::request<int> {};
+struct Handler
+  : holden::request_handler<Req<0>>
+  , holden::request_handler<Req<1>>
+  , holden::request_handler<Req<2>>
+  , holden::request_handler<Req<3>> {
+  template <int I> int handle(const Req<I>&) { return I + $1; }
+};
+int run() {
+  Handler h;
+  auto m = holden::make_mediator(h);
+  return m.send(Req<0>{}) + m.send(Req<1>{}) + m.send(Req<2>{})
+       + m.send(Req<3>{});
+}
+} // namespace tu$1
+TU
+}
+
+i=0
+while [ "$i" -lt "$tus" ]; do
+  generate "$i" "#include \"$root/include/cpp_mediator/mediator.hpp\"" > header_$i.cc
+  generate "$i" "import cpp_mediator;" > module_$i.cc
+  i=$((i + 1))
+done
+
+start=$(now_ms)
+i=0
+while [ "$i" -lt "$tus" ]; do
+  "$cxx" -std=c++20 -O0 -c header_$i.cc -o header_$i.o
+  i=$((i + 1))
+done
+header_ms=$(( $(now_ms) - start ))
+
+start=$(now_ms)
+"$cxx" -std=c++20 -fmodules-ts -x c++-system-header tuple
+"$cxx" -std=c++20 -fmodules-ts -x c++ -c \
+  "$root/include/cpp_mediator/cpp_mediator.cppm" -o cpp_mediator.o
+module_once_ms=$(( $(now_ms) - start ))
+i=0
+while [ "$i" -lt "$tus" ]; do
+  "$cxx" -std=c++20 -fmodules-ts -O0 -c module_$i.cc -o module_$i.o
+  i=$((i + 1))
+done
+module_ms=$(( $(now_ms) - start ))
+
+echo "$tus translation units, $cxx -std=c++20 -O0, one at a time"
+printf "%-24s %8d ms\n" "#include mediator.hpp" "$header_ms"
+printf "%-24s %8d ms  (%d ms building the module)\n" "import cpp_mediator" \
+  "$module_ms" "$module_once_ms"
@@ -0,0 +1,106 @@
+// Compares the round-trip latency of a request handled in a child process
+// through `process_proxy` (shared-memory rings + futexes) against the same
+// exchange over a Unix domain socket pair.
+//
+// usage: process_proxy_latency [round_trips]
+
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/process_proxy.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct Quote {
+  using response_type = long;
+  long symbol;
+  long quantity;
+};
+
+struct Pricer : holden::request_handler<Quote> {
+  long handle(const Quote& q) { return q.symbol * 3 + q.quantity; }
+};
+
+void report(const char* name, std::vector<double>& samples) {
+  std::sort(samples.begin(), samples.end());
+  auto pct = [&](double p) {
+    return samples[static_cast<std::size_t>(p * double(samples.size() - 1))];
+  };
+  std::printf("%-22s p50 %8.0f ns   p99 %8.0f ns   p99.9 %8.0f ns\n",
+              name, pct(0.5), pct(0.99), pct(0.999));
+}
+
+template <typename RoundTrip>
+void measure(const char* name, int round_trips, RoundTrip&& round_trip) {
+  std::vector<double> samples;
+  samples.reserve(static_cast<std::size_t>(round_trips));
+  for (int i = 0; i < round_trips; ++i) {
+    const auto start = clock_type::now();
+    if (round_trip(Quote{i, 1}) != i * 3 + 1) std::abort();
+    samples.push_back(std::chrono::duration<double, std::nano>(
+        clock_type::now() - start).count());
+  }
+  report(name, samples);
+}
+
+bool read_exact(int fd, void* buffer, std::size_t size) {
+  auto* bytes = static_cast<char*>(buffer);
+  while (size > 0) {
+    const ssize_t n = ::read(fd, bytes, size);
+    if (n <= 0) return false;
+    bytes += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+void measure_socket(int round_trips) {
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) std::abort();
+  const pid_t child = ::fork();
+  if (child == 0) {
+    ::close(fds[0]);
+    Pricer pricer;
+    Quote q;
+    while (read_exact(fds[1], &q, sizeof(q))) {
+      const long response = pricer.handle(q);
+      if (::write(fds[1], &response, sizeof(response)) < 0) break;
+    }
+    ::_exit(0);
+  }
+  ::close(fds[1]);
+  measure("unix domain socket", round_trips, [&](const Quote& q) {
+    long response = 0;
+    if (::write(fds[0], &q, sizeof(q)) < 0) std::abort();
+    if (!read_exact(fds[0], &response, sizeof(response))) std::abort();
+    return response;
+  });
+  ::close(fds[0]);
+  ::waitpid(child, nullptr, 0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int round_trips = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+  {
+    Pricer pricer;
+    holden::process_proxy<Pricer, Quote> proxy(pricer);
+    auto m = holden::make_mediator(proxy);
+    measure("shared-memory proxy", round_trips,
+            [&](const Quote& q) { return m.send(q); });
+  }
+  measure_socket(round_trips);
+  return 0;
+}
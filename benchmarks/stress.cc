@@ -0,0 +1,224 @@
+// Drives a mediator from 1 up to `max_threads` threads under each way it
+// can be shared between threads, and reports throughput and per-send
+// latency percentiles for each thread count:
+//
+//   synchronized  every thread sends directly; the hot handler is wrapped
+//                 in `synchronized<>`, so hot sends contend on its lock
+//   future        every send goes through one dispatcher via `send_async`
+//                 and the sender waits on the future
+//   send_then     as above, pipelined with `send_then`; latency is from
+//                 queueing to the continuation running
+//
+// Each send goes to the shared hot handler with probability `hot_percent`,
+// otherwise to a stateless cold one; both spin for `cost_ns` to model work.
+//
+// usage: stress [sends_per_thread] [max_threads] [hot_percent] [cost_ns]
+//
+// Built with -DTSAN=ON this also runs under ctest with a small workload,
+// which is the way to validate the concurrent paths; numbers from such a
+// build are not meaningful.
+
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/synchronized.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config {
+  int sends;
+  int max_threads;
+  int hot_percent;
+  int cost_ns;
+};
+
+void burn(int ns) {
+  const auto until = clock_type::now() + std::chrono::nanoseconds(ns);
+  while (clock_type::now() < until) holden::detail::cpu_relax();
+}
+
+struct Hot {
+  using response_type = std::uint64_t;
+};
+
+struct Cold {
+  using response_type = std::uint64_t;
+  std::uint64_t value;
+};
+
+// Unsynchronised state; only safe behind `synchronized<>` or a dispatcher.
+struct HotHandler : holden::request_handler<Hot> {
+  int cost_ns;
+  std::uint64_t count = 0;
+  std::uint64_t handle(const Hot&) { burn(cost_ns); return ++count; }
+};
+
+struct ColdHandler : holden::request_handler<Cold> {
+  int cost_ns;
+  std::uint64_t handle(const Cold& c) const { burn(cost_ns); return c.value; }
+};
+
+// Per-thread latency samples in nanoseconds.
+using samples_t = std::vector<std::vector<double>>;
+
+struct report {
+  double seconds;
+  samples_t samples;
+};
+
+// Runs `body(thread, sends, rng, samples)` on `threads` threads released
+// together, and times the whole run.
+template <typename Body>
+report run_threads(int threads, int sends, Body&& body) {
+  report out{0, samples_t(static_cast<std::size_t>(threads))};
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; ++t) {
+    auto& samples = out.samples[static_cast<std::size_t>(t)];
+    samples.resize(static_cast<std::size_t>(sends));
+    pool.emplace_back([&, t] {
+      std::minstd_rand rng(static_cast<std::uint32_t>(t + 1));
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+      body(t, sends, rng, samples);
+    });
+  }
+  while (ready.load() < threads) std::this_thread::yield();
+  const auto start = clock_type::now();
+  go.store(true, std::memory_order_release);
+  for (auto& th : pool) th.join();
+  out.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  return out;
+}
+
+void print(const char* mode, int threads, int sends, report r) {
+  std::vector<double> all;
+  for (auto& s : r.samples) all.insert(all.end(), s.begin(), s.end());
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) {
+    return all[static_cast<std::size_t>(p * double(all.size() - 1))];
+  };
+  const double total = double(threads) * sends;
+  std::printf("%-13s %3d threads  %9.3f Msends/s   p50 %8.0f ns   "
+              "p99 %8.0f ns   p99.9 %8.0f ns\n",
+              mode, threads, total / r.seconds / 1e6,
+              pct(0.5), pct(0.99), pct(0.999));
+}
+
+bool is_hot(std::minstd_rand& rng, int hot_percent) {
+  return static_cast<int>(rng() % 100) < hot_percent;
+}
+
+template <typename F>
+double time_ns(F&& f) {
+  const auto start = clock_type::now();
+  f();
+  return std::chrono::duration<double, std::nano>(clock_type::now() - start)
+      .count();
+}
+
+void stress_synchronized(const config& c, int threads) {
+  HotHandler hot{};
+  hot.cost_ns = c.cost_ns;
+  ColdHandler cold{};
+  cold.cost_ns = c.cost_ns;
+  holden::synchronized<HotHandler> locked(hot);
+  auto m = holden::make_mediator(locked, cold);
+
+  print("synchronized", threads, c.sends,
+        run_threads(threads, c.sends,
+                    [&](int, int n, std::minstd_rand& rng,
+                        std::vector<double>& samples) {
+    for (int i = 0; i < n; ++i) {
+      const bool h = is_hot(rng, c.hot_percent);
+      samples[static_cast<std::size_t>(i)] = time_ns([&] {
+        if (h) m.send(Hot{});
+        else m.send(Cold{std::uint64_t(i)});
+      });
+    }
+  }));
+  if (hot.count > std::uint64_t(threads) * std::uint64_t(c.sends)) std::abort();
+}
+
+void stress_future(const config& c, int threads) {
+  HotHandler hot{};
+  hot.cost_ns = c.cost_ns;
+  ColdHandler cold{};
+  cold.cost_ns = c.cost_ns;
+  auto m = holden::make_mediator(hot, cold);
+  holden::dispatcher<decltype(m), holden::spin_then_park_wait> d(m);
+
+  print("future", threads, c.sends,
+        run_threads(threads, c.sends,
+                    [&](int, int n, std::minstd_rand& rng,
+                        std::vector<double>& samples) {
+    for (int i = 0; i < n; ++i) {
+      const bool h = is_hot(rng, c.hot_percent);
+      samples[static_cast<std::size_t>(i)] = time_ns([&] {
+        if (h) d.send_async(Hot{}).get();
+        else d.send_async(Cold{std::uint64_t(i)}).get();
+      });
+    }
+  }));
+}
+
+void stress_then(const config& c, int threads) {
+  HotHandler hot{};
+  hot.cost_ns = c.cost_ns;
+  ColdHandler cold{};
+  cold.cost_ns = c.cost_ns;
+  auto m = holden::make_mediator(hot, cold);
+  holden::dispatcher<decltype(m), holden::spin_then_park_wait> d(m);
+
+  print("send_then", threads, c.sends,
+        run_threads(threads, c.sends,
+                    [&](int, int n, std::minstd_rand& rng,
+                        std::vector<double>& samples) {
+    std::atomic<int> completed{0};
+    for (int i = 0; i < n; ++i) {
+      auto record = [&samples, &completed, i, start = clock_type::now()](
+          holden::result<std::uint64_t>) {
+        samples[static_cast<std::size_t>(i)] =
+            std::chrono::duration<double, std::nano>(clock_type::now() - start)
+                .count();
+        completed.fetch_add(1, std::memory_order_release);
+      };
+      if (is_hot(rng, c.hot_percent)) d.send_then(Hot{}, record);
+      else d.send_then(Cold{std::uint64_t(i)}, record);
+    }
+    while (completed.load(std::memory_order_acquire) < n)
+      std::this_thread::yield();
+  }));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  config c;
+  c.sends = argc > 1 ? std::atoi(argv[1]) : 20000;
+  c.max_threads = argc > 2 ? std::atoi(argv[2]) : 64;
+  c.hot_percent = argc > 3 ? std::atoi(argv[3]) : 20;
+  c.cost_ns = argc > 4 ? std::atoi(argv[4]) : 100;
+
+  std::printf("%d sends per thread, %d%% hot, %d ns per handler, %u cpus\n",
+              c.sends, c.hot_percent, c.cost_ns,
+              std::thread::hardware_concurrency());
+  for (int threads = 1; threads <= c.max_threads; threads *= 2) {
+    stress_synchronized(c, threads);
+    stress_future(c, threads);
+    stress_then(c, threads);
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+#ifndef HOLDEN_CHILD_MEDIATOR_HPP_
+#define HOLDEN_CHILD_MEDIATOR_HPP_
+
+#include "mediator.hpp"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace holden {
+
+// A mediator layered over a parent: requests one of its own handlers
+// handles go to that handler, all others to the parent. Useful to shadow
+// some of a long-lived mediator's handlers for one scope, e.g. with
+// tenant-specific overrides:
+//
+//   auto tenant = make_child_mediator(service, tenant_quota);
+//   tenant.send(CheckQuota{})  // tenant_quota
+//   tenant.send(GetUser{})     // whatever `service` sends it to
+//
+// Which of the two gets a request is decided at compile time from the
+// handler lists, so a send through a child costs the same as a send
+// through whichever mediator handles it. The parent may itself be a
+// child; it must outlive the child.
+template <typename Parent, typename... Handlers>
+class child_mediator {
+  Parent& parent_;
+  mediator<Handlers...> own_;
+
+  // Also true when one of the child's handlers takes a base of the request
+  // (see `base_request`), even if the parent handles the request exactly.
+  template <typename TRequest>
+  using handles_own = std::integral_constant<bool,
+    detail::tuple_searching::handler_count<
+      detail::tuple_searching::resolve_request_t<
+        std::decay_t<TRequest>, std::tuple<Handlers...>>,
+      std::tuple<Handlers...>>() != 0>;
+
+  template <typename TRequest>
+  HOLDEN_MEDIATOR_ALWAYS_INLINE
+  auto send_to(const TRequest& r, std::true_type)
+  -> typename TRequest::response_type {
+    return own_.send(r);
+  }
+
+  template <typename TRequest>
+  HOLDEN_MEDIATOR_ALWAYS_INLINE
+  auto send_to(const TRequest& r, std::false_type)
+  -> typename TRequest::response_type {
+    return parent_.send(r);
+  }
+
+ public:
+  child_mediator(Parent& parent, Handlers... handlers)
+    : parent_(parent), own_(handlers...) {}
+
+  template <typename TRequest>
+  HOLDEN_MEDIATOR_ALWAYS_INLINE
+  auto send(const TRequest& r) -> typename TRequest::response_type {
+    return send_to(r, handles_own<TRequest>());
+  }
+
+  // Whether a `TRequest` is handled here rather than by the parent.
+  template <typename TRequest>
+  static constexpr bool handles() { return handles_own<TRequest>::value; }
+
+  Parent& parent() const { return parent_; }
+
+  // This child's own handlers only, without the parent's.
+  const std::tuple<Handlers...>& handlers() const { return own_.handlers(); }
+};
+
+template <typename Parent, typename... Args>
+child_mediator<Parent, Args&...>
+make_child_mediator(Parent& parent, Args&... args) {
+  return child_mediator<Parent, Args&...>(parent, args...);
+}
+
+} // namespace holden
+
+#endif // HOLDEN_CHILD_MEDIATOR_HPP_
@@ -0,0 +1,122 @@
+#ifndef HOLDEN_COMPLETION_QUEUE_HPP_
+#define HOLDEN_COMPLETION_QUEUE_HPP_
+
+#include "detail/bounded_queue.hpp"
+#include "detail/cpu.hpp"
+#include "detail/task.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+namespace holden {
+
+// Hands completions of async sends back to an event loop thread.
+//
+// Workers `post` completion callbacks; the loop registers `native_handle()`
+// with epoll/poll/select for readability and calls `drain()` when it fires,
+// which runs the queued callbacks on the loop thread. The descriptor is only
+// signalled on the empty -> non-empty transition, so a burst of completions
+// costs one `write` and one wake-up instead of one per response.
+//
+// Backed by an eventfd on Linux and a non-blocking pipe elsewhere.
+template <std::size_t Capacity = 1024>
+class completion_queue {
+  detail::bounded_queue<detail::task, Capacity> queue_;
+  std::atomic<bool> signalled_{false};
+  int read_fd_;
+  int write_fd_;
+
+ public:
+  completion_queue() {
+#if defined(__linux__)
+    read_fd_ = write_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (read_fd_ < 0) throw_errno("eventfd");
+#else
+    int fds[2];
+    if (::pipe(fds) != 0) throw_errno("pipe");
+    for (int fd : fds) {
+      ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+      ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+#endif
+  }
+
+  completion_queue(const completion_queue&) = delete;
+  completion_queue& operator=(const completion_queue&) = delete;
+
+  ~completion_queue() {
+    ::close(read_fd_);
+    if (write_fd_ != read_fd_) ::close(write_fd_);
+  }
+
+  // Becomes readable whenever completions are waiting to be drained.
+  int native_handle() const { return read_fd_; }
+
+  // Queues `callback` to run on the draining thread. Callable from any
+  // thread; spins while the queue is full.
+  void post(detail::task callback) {
+    for (unsigned attempt = 0; !queue_.try_push(std::move(callback));
+         ++attempt) {
+      if (attempt < 64) detail::cpu_relax();
+      else std::this_thread::yield();
+    }
+    if (!signalled_.exchange(true, std::memory_order_seq_cst)) signal();
+  }
+
+  // Runs up to `max_batch` queued callbacks on the calling thread and returns
+  // how many ran. If callbacks remain afterwards the descriptor stays
+  // readable, so a level-triggered loop comes back for the rest.
+  std::size_t drain(
+      std::size_t max_batch = std::numeric_limits<std::size_t>::max()) {
+    clear_signal();
+    signalled_.store(false, std::memory_order_seq_cst);
+
+    std::size_t ran = 0;
+    detail::task callback;
+    while (ran < max_batch && queue_.try_pop(callback)) {
+      callback();
+      callback.reset();
+      ++ran;
+    }
+    if (!queue_.empty() && !signalled_.exchange(true)) signal();
+    return ran;
+  }
+
+ private:
+  void signal() {
+#if defined(__linux__)
+    const std::uint64_t one = 1;
+    while (::write(write_fd_, &one, sizeof(one)) < 0 && errno == EINTR) {}
+#else
+    const char one = 1;
+    while (::write(write_fd_, &one, 1) < 0 && errno == EINTR) {}
+#endif
+  }
+
+  void clear_signal() {
+    char buffer[64];
+    while (::read(read_fd_, buffer, sizeof(buffer)) > 0) {}
+  }
+
+  static void throw_errno(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_COMPLETION_QUEUE_HPP_
@@ -0,0 +1,22 @@
+// The `cpp_mediator` named module: mediator.hpp, compiled once.
+//
+//   import cpp_mediator;
+//
+// Build `<tuple>` as a header unit first; the module re-exports it, since
+// GCC 12 cannot instantiate a `std::tuple` it saw in another module's
+// global module fragment; with GCC 12, import the module after any
+// textual #include of standard headers, not before. Macros
+// (HOLDEN_MEDIATOR_*) are not exported; set them when building the module.
+// See the MODULES option in CMakeLists.txt.
+
+module;
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+export module cpp_mediator;
+export import <tuple>;
+export {
+#include "mediator.hpp"
+}
@@ -0,0 +1,123 @@
+#ifndef HOLDEN_DETAIL_BOUNDED_QUEUE_HPP_
+#define HOLDEN_DETAIL_BOUNDED_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace holden {
+namespace detail {
+
+constexpr std::size_t cache_line_size = 64;
+
+// A fixed-capacity multi-producer/multi-consumer ring (D. Vyukov's bounded
+// queue). Each cell carries a sequence number telling producers and
+// consumers whose turn it is, so neither side takes a lock. The storage is
+// inline and address-free, so a queue may live in static or shared memory.
+template <typename T, std::size_t Capacity>
+class bounded_queue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "queue capacity must be a power of two");
+
+  struct cell {
+    std::atomic<std::size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  cell cells_[Capacity];
+  char pad0_[cache_line_size];
+  std::atomic<std::size_t> enqueue_pos_;
+  char pad1_[cache_line_size - sizeof(std::atomic<std::size_t>)];
+  std::atomic<std::size_t> dequeue_pos_;
+  char pad2_[cache_line_size - sizeof(std::atomic<std::size_t>)];
+
+ public:
+  static constexpr std::size_t capacity = Capacity;
+
+  bounded_queue() : enqueue_pos_(0), dequeue_pos_(0) {
+    for (std::size_t i = 0; i < Capacity; ++i)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  bounded_queue(const bounded_queue&) = delete;
+  bounded_queue& operator=(const bounded_queue&) = delete;
+
+  ~bounded_queue() {
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    const std::size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+    for (; pos != end; ++pos)
+      item(cells_[pos & (Capacity - 1)]).~T();
+  }
+
+  // Returns false, leaving `value` untouched, when the queue is full.
+  template <typename U>
+  bool try_push(U&& value) {
+    cell* c;
+    std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells_[pos & (Capacity - 1)];
+      const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void*>(c->storage)) T(std::forward<U>(value));
+    c->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false when the queue is empty.
+  bool try_pop(T& out) {
+    cell* c;
+    std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      c = &cells_[pos & (Capacity - 1)];
+      const std::size_t seq = c->sequence.load(std::memory_order_acquire);
+      const auto diff = static_cast<std::ptrdiff_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T& value = item(*c);
+    out = std::move(value);
+    value.~T();
+    c->sequence.store(pos + Capacity, std::memory_order_release);
+    return true;
+  }
+
+  // A snapshot; only exact while no other thread touches the queue.
+  bool empty() const {
+    return size() == 0;
+  }
+
+  std::size_t size() const {
+    const std::size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    const std::size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+
+ private:
+  static T& item(cell& c) {
+    return *reinterpret_cast<T*>(c.storage);
+  }
+};
+
+} // namespace detail
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_BOUNDED_QUEUE_HPP_
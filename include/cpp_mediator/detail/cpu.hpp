@@ -0,0 +1,43 @@
+#ifndef HOLDEN_DETAIL_CPU_HPP_
+#define HOLDEN_DETAIL_CPU_HPP_
+
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace holden {
+namespace detail {
+
+// Tells the core we are in a spin loop, so a sibling hyperthread gets the
+// execution resources and the loop exit is not mis-speculated.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield" ::: "memory");
+#endif
+}
+
+// Restricts `thread` to run on `cpu` only. Returns false when the platform
+// has no affinity support or the cpu is not available to this process.
+inline bool pin_thread_to_cpu(std::thread& thread, int cpu) {
+#if defined(__linux__)
+  if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(static_cast<std::size_t>(cpu), &set);
+  return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+  (void)thread;
+  (void)cpu;
+  return false;
+#endif
+}
+
+} // namespace detail
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_CPU_HPP_
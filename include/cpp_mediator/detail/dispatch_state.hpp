@@ -0,0 +1,104 @@
+#ifndef HOLDEN_DETAIL_DISPATCH_STATE_HPP_
+#define HOLDEN_DETAIL_DISPATCH_STATE_HPP_
+
+#include <cstddef>
+
+namespace holden {
+namespace detail {
+
+// The handler calls and locks a fiber added on top of the thread it runs
+// on, set aside while the fiber is suspended (see fiber.hpp).
+struct fiber_dispatch {
+  static constexpr std::size_t max_held = 32;
+
+  std::size_t depth = 0;
+  const void* held[max_held];
+  std::size_t held_count = 0;
+};
+
+// What the current thread is in the middle of dispatching: how many handler
+// calls are on its stack, which handler locks it holds, and which dispatcher
+// (if any) it is the worker of. Lets nested sends from inside `handle` be
+// recognised and run inline instead of deadlocking.
+//
+// A thread running fibers swaps each fiber's share of this in and out as it
+// switches between them, so one fiber's locks never make another's sends
+// look reentrant. While a fiber runs, `yield_fiber(fiber_scheduler)` lets
+// the others run, e.g. so one waiting for a lock held by another fiber does
+// not block the thread that fiber needs.
+struct dispatch_state {
+  static constexpr std::size_t max_held = fiber_dispatch::max_held;
+
+  std::size_t depth = 0;
+  const void* held[max_held];
+  std::size_t held_count = 0;
+  const void* worker_of = nullptr;
+  void (*yield_fiber)(void*) = nullptr;
+  void* fiber_scheduler = nullptr;
+
+  bool holds(const void* lock) const {
+    for (std::size_t i = 0; i < held_count; ++i)
+      if (held[i] == lock) return true;
+    return false;
+  }
+
+  bool can_hold_more() const { return held_count < max_held; }
+
+  // Only once `can_hold_more()`.
+  void push_held(const void* lock) { held[held_count++] = lock; }
+
+  void pop_held(const void* lock) {
+    std::size_t i = held_count;
+    while (i > 0 && held[i - 1] != lock) --i;
+    if (i == 0) return;
+    for (; i < held_count; ++i) held[i - 1] = held[i];
+    --held_count;
+  }
+
+  // Adds a resumed fiber's calls and locks to the thread's. Returns false,
+  // adding nothing, if its locks do not fit.
+  bool resume(const fiber_dispatch& fiber) {
+    if (held_count + fiber.held_count > max_held) return false;
+    depth += fiber.depth;
+    for (std::size_t i = 0; i < fiber.held_count; ++i)
+      held[held_count++] = fiber.held[i];
+    return true;
+  }
+
+  // Moves what a suspended fiber added since `resume` back into `fiber`.
+  void suspend(fiber_dispatch& fiber, std::size_t base_depth,
+               std::size_t base_held) {
+    fiber.depth = depth - base_depth;
+    fiber.held_count = held_count - base_held;
+    for (std::size_t i = 0; i < fiber.held_count; ++i)
+      fiber.held[i] = held[base_held + i];
+    depth = base_depth;
+    held_count = base_held;
+  }
+};
+
+inline dispatch_state& this_thread_dispatch() {
+  static thread_local dispatch_state state;
+  return state;
+}
+
+// Counts a handler call on this thread's stack for as long as it lives.
+struct dispatch_frame {
+  dispatch_state& state;
+  explicit dispatch_frame(dispatch_state& s) : state(s) { ++state.depth; }
+  ~dispatch_frame() { --state.depth; }
+  dispatch_frame(const dispatch_frame&) = delete;
+  dispatch_frame& operator=(const dispatch_frame&) = delete;
+};
+
+} // namespace detail
+
+// Number of handler calls currently on the calling thread's stack that went
+// through a dispatcher worker or a `synchronized` handler.
+inline std::size_t this_thread_dispatch_depth() {
+  return detail::this_thread_dispatch().depth;
+}
+
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_DISPATCH_STATE_HPP_
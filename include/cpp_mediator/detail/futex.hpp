@@ -0,0 +1,171 @@
+#ifndef HOLDEN_DETAIL_FUTEX_HPP_
+#define HOLDEN_DETAIL_FUTEX_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#endif
+
+// ThreadSanitizer does not model standalone fences, so under it the fences
+// below are replaced by equivalent read-modify-writes it can see.
+#if !defined(HOLDEN_MEDIATOR_TSAN)
+#if defined(__SANITIZE_THREAD__)
+#define HOLDEN_MEDIATOR_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define HOLDEN_MEDIATOR_TSAN 1
+#endif
+#endif
+#endif
+
+namespace holden {
+namespace detail {
+
+#if defined(__linux__)
+
+// Futexes in memory shared between processes must use the non-private
+// operations; private ones are cheaper and the default.
+inline int futex_op(int op, bool process_shared) {
+  return process_shared ? op : (op | FUTEX_PRIVATE_FLAG);
+}
+
+// Sleeps while `word` still holds `expected`. May return spuriously.
+inline void futex_wait(std::atomic<std::uint32_t>& word,
+                       std::uint32_t expected, bool process_shared = false) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+          futex_op(FUTEX_WAIT, process_shared), expected, nullptr, nullptr, 0);
+}
+
+// As futex_wait, but gives up after `timeout`.
+inline void futex_wait_for(std::atomic<std::uint32_t>& word,
+                           std::uint32_t expected,
+                           std::chrono::nanoseconds timeout,
+                           bool process_shared = false) {
+  const auto secs = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(secs.count());
+  ts.tv_nsec = static_cast<long>((timeout - secs).count());
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+          futex_op(FUTEX_WAIT, process_shared), expected, &ts, nullptr, 0);
+}
+
+// Wakes up to `count` threads sleeping on `word`.
+inline void futex_wake(std::atomic<std::uint32_t>& word, int count,
+                       bool process_shared = false) {
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word),
+          futex_op(FUTEX_WAKE, process_shared), count, nullptr, nullptr, 0);
+}
+
+#else
+
+// Without futexes, sleepers park on one of a fixed set of condition
+// variables picked by the address of the word they wait on. This only works
+// within one process.
+struct parking_bucket {
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+inline parking_bucket& parking_bucket_for(const void* address) {
+  static parking_bucket buckets[64];
+  return buckets[std::hash<const void*>()(address) % 64];
+}
+
+inline void futex_wait(std::atomic<std::uint32_t>& word,
+                       std::uint32_t expected, bool = false) {
+  auto& bucket = parking_bucket_for(&word);
+  std::unique_lock<std::mutex> lock(bucket.mutex);
+  if (word.load() == expected) bucket.cv.wait(lock);
+}
+
+inline void futex_wait_for(std::atomic<std::uint32_t>& word,
+                           std::uint32_t expected,
+                           std::chrono::nanoseconds timeout, bool = false) {
+  auto& bucket = parking_bucket_for(&word);
+  std::unique_lock<std::mutex> lock(bucket.mutex);
+  if (word.load() == expected) bucket.cv.wait_for(lock, timeout);
+}
+
+inline void futex_wake(std::atomic<std::uint32_t>& word, int, bool = false) {
+  auto& bucket = parking_bucket_for(&word);
+  std::lock_guard<std::mutex> lock(bucket.mutex);
+  bucket.cv.notify_all();
+}
+
+#endif
+
+// Lets consumers sleep until a producer signals new work, without producers
+// paying for a syscall while nobody is asleep.
+//
+// consumer:  key = prepare_wait(); if (ready) cancel_wait(); else wait(key);
+// producer:  publish work; notify_one();
+//
+// An event_count placed in shared memory can be used across processes when
+// constructed with `process_shared`.
+class event_count {
+  std::atomic<std::uint32_t> epoch_{0};
+  std::atomic<std::uint32_t> waiters_{0};
+  bool process_shared_;
+
+ public:
+  explicit event_count(bool process_shared = false)
+    : process_shared_(process_shared) {}
+
+  std::uint32_t prepare_wait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+#if defined(HOLDEN_MEDIATOR_TSAN)
+    return epoch_.fetch_add(0, std::memory_order_seq_cst);
+#else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_acquire);
+#endif
+  }
+
+  void cancel_wait() {
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void wait(std::uint32_t key) {
+    while (epoch_.load(std::memory_order_acquire) == key)
+      futex_wait(epoch_, key, process_shared_);
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // As wait, but returns after `timeout` even without a notification.
+  void wait_for(std::uint32_t key, std::chrono::nanoseconds timeout) {
+    if (epoch_.load(std::memory_order_acquire) == key)
+      futex_wait_for(epoch_, key, timeout, process_shared_);
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void notify_one() { notify(1); }
+  void notify_all() { notify(INT32_MAX); }
+
+ private:
+  void notify(int count) {
+#if defined(HOLDEN_MEDIATOR_TSAN)
+    if (waiters_.fetch_add(0, std::memory_order_seq_cst) == 0) return;
+#else
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+#endif
+    epoch_.fetch_add(1, std::memory_order_release);
+    futex_wake(epoch_, count, process_shared_);
+  }
+};
+
+} // namespace detail
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_FUTEX_HPP_
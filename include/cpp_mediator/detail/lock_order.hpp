@@ -0,0 +1,107 @@
+#ifndef HOLDEN_DETAIL_LOCK_ORDER_HPP_
+#define HOLDEN_DETAIL_LOCK_ORDER_HPP_
+
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace holden {
+
+// Describes two handler locks seen taken in both orders, which can deadlock
+// once the two call paths run concurrently.
+struct lock_order_violation {
+  const char* acquiring;  // type of the handler being locked
+  const char* held;       // type of a handler already locked by this thread
+};
+
+using lock_order_violation_handler = void (*)(const lock_order_violation&);
+
+namespace detail {
+
+inline void print_lock_order_violation(const lock_order_violation& v) {
+  std::fprintf(stderr,
+               "holden::mediator: lock order cycle: locking handler %s while "
+               "holding %s, which elsewhere is locked while holding it\n",
+               v.acquiring, v.held);
+}
+
+// Records which handler locks have been taken while holding which others,
+// and reports when a new edge closes a cycle. Only used in debug builds.
+class lock_order_graph {
+  std::mutex mutex_;
+  std::unordered_map<const void*, std::unordered_set<const void*>> after_;
+  std::unordered_map<const void*, const char*> names_;
+  lock_order_violation_handler report_ = &print_lock_order_violation;
+
+ public:
+  static lock_order_graph& instance() {
+    static lock_order_graph graph;
+    return graph;
+  }
+
+  lock_order_violation_handler set_handler(lock_order_violation_handler h) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto previous = report_;
+    report_ = h ? h : &print_lock_order_violation;
+    return previous;
+  }
+
+  void name(const void* lock_id, const char* name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    names_[lock_id] = name;
+  }
+
+  // Notes that `acquiring` is being locked while `held` is held.
+  void on_acquire(const void* held, const void* acquiring) {
+    lock_order_violation_handler report;
+    lock_order_violation violation;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!after_[held].insert(acquiring).second) return;
+      if (!reaches(acquiring, held)) return;
+      report = report_;
+      violation = { names_[acquiring], names_[held] };
+    }
+    report(violation);
+  }
+
+  void forget(const void* lock_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    after_.erase(lock_id);
+    names_.erase(lock_id);
+    for (auto& edges : after_) edges.second.erase(lock_id);
+  }
+
+ private:
+  bool reaches(const void* from, const void* to) const {
+    std::vector<const void*> pending{from};
+    std::unordered_set<const void*> seen{from};
+    while (!pending.empty()) {
+      const void* node = pending.back();
+      pending.pop_back();
+      auto edges = after_.find(node);
+      if (edges == after_.end()) continue;
+      for (const void* next : edges->second) {
+        if (next == to) return true;
+        if (seen.insert(next).second) pending.push_back(next);
+      }
+    }
+    return false;
+  }
+};
+
+} // namespace detail
+
+// Replaces what happens when a lock order cycle is detected (by default, a
+// warning on stderr) and returns the previous handler. Passing null restores
+// the default.
+inline lock_order_violation_handler set_lock_order_violation_handler(
+    lock_order_violation_handler handler) {
+  return detail::lock_order_graph::instance().set_handler(handler);
+}
+
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_LOCK_ORDER_HPP_
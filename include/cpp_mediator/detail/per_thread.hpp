@@ -0,0 +1,187 @@
+#ifndef HOLDEN_DETAIL_PER_THREAD_HPP_
+#define HOLDEN_DETAIL_PER_THREAD_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace holden {
+namespace detail {
+
+// Live `per_thread` tables by id. Ids are recycled, so every thread's
+// lookup vector is as long as the most tables ever alive at once; a
+// generation number tells a table from an earlier one with its id.
+class per_thread_registry {
+ public:
+  using exit_fn = void (*)(void* owner, std::uintptr_t value);
+
+  struct binding {
+    std::uint64_t generation = 0;
+    std::uintptr_t value = 0;
+  };
+
+  static per_thread_registry& instance() {
+    static per_thread_registry registry;
+    return registry;
+  }
+
+  std::size_t add(void* owner, exit_fn on_exit, std::uint64_t& generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation = ++generations_;
+    std::size_t id;
+    if (!free_ids_.empty()) {
+      id = free_ids_.back();
+      free_ids_.pop_back();
+    } else {
+      id = tables_.size();
+      tables_.emplace_back();
+    }
+    tables_[id] = table{generation, owner, on_exit};
+    return id;
+  }
+
+  // Once this returns, no exiting thread calls back into the table; waits
+  // for calls already under way.
+  void remove(std::size_t id) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [&] { return tables_[id].running == 0; });
+    tables_[id] = table{};
+    free_ids_.push_back(id);
+  }
+
+  // The calling thread's bindings, by table id.
+  static std::vector<binding>& thread_bindings() {
+    thread_local thread_exit exit;
+    return exit.bindings;
+  }
+
+ private:
+  struct table {
+    std::uint64_t generation;
+    void* owner;
+    exit_fn on_exit;
+    // Exiting threads calling `on_exit` right now.
+    std::size_t running = 0;
+  };
+
+  struct exit_call {
+    std::size_t id;
+    void* owner;
+    exit_fn on_exit;
+    std::uintptr_t value;
+  };
+
+  // Hands each binding of an exiting thread back to its table, if that
+  // table is still alive. The calls are collected under the lock and made
+  // after releasing it; values they bind are handed back in turn.
+  struct thread_exit {
+    std::vector<binding> bindings;
+
+    ~thread_exit() {
+      auto& registry = instance();
+      while (!bindings.empty()) {
+        std::vector<binding> exiting;
+        exiting.swap(bindings);
+
+        std::vector<exit_call> calls;
+        {
+          std::lock_guard<std::mutex> lock(registry.mutex_);
+          for (std::size_t id = 0; id < exiting.size(); ++id) {
+            const auto& b = exiting[id];
+            if (b.generation == 0 || id >= registry.tables_.size()) continue;
+            auto& t = registry.tables_[id];
+            if (t.generation != b.generation) continue;
+            ++t.running;
+            calls.push_back({id, t.owner, t.on_exit, b.value});
+          }
+        }
+        for (const auto& c : calls) c.on_exit(c.owner, c.value);
+        {
+          std::lock_guard<std::mutex> lock(registry.mutex_);
+          for (const auto& c : calls) --registry.tables_[c.id].running;
+        }
+        registry.idle_.notify_all();
+      }
+    }
+  };
+
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  std::uint64_t generations_ = 0;
+  std::vector<table> tables_;
+  std::vector<std::size_t> free_ids_;
+};
+
+// One `T` (a pointer or an integer) per thread for the object owning it,
+// found with an indexed load and a compare. When a thread exits, its value
+// is passed to `on_exit(owner, value)`, which the table's destructor waits
+// for, so `on_exit` must not destroy its own table; values of threads still
+// running when the table is destroyed are for the owner to clean up.
+template <typename T>
+class per_thread {
+  static_assert(std::is_pointer<T>::value || std::is_integral<T>::value,
+                "per_thread holds a pointer or an integer");
+
+  std::uint64_t generation_ = 0;
+  const std::size_t id_;
+
+  static std::uintptr_t to_word(T v, std::true_type) {
+    return reinterpret_cast<std::uintptr_t>(v);
+  }
+  static std::uintptr_t to_word(T v, std::false_type) {
+    return static_cast<std::uintptr_t>(v);
+  }
+  static T from_word(std::uintptr_t w, std::true_type) {
+    return reinterpret_cast<T>(w);
+  }
+  static T from_word(std::uintptr_t w, std::false_type) {
+    return static_cast<T>(w);
+  }
+
+ public:
+  using exit_fn = void (*)(void* owner, T value);
+
+  template <typename Owner, void (*OnExit)(Owner*, T)>
+  static per_thread make(Owner* owner) {
+    return per_thread(owner, [](void* o, std::uintptr_t w) {
+      OnExit(static_cast<Owner*>(o), from_word(w, std::is_pointer<T>()));
+    });
+  }
+
+  per_thread(void* owner, per_thread_registry::exit_fn on_exit)
+    : id_(per_thread_registry::instance().add(owner, on_exit, generation_)) {}
+
+  per_thread(per_thread&& other)
+    : generation_(other.generation_), id_(other.id_) {
+    other.generation_ = 0;
+  }
+  per_thread(const per_thread&) = delete;
+  per_thread& operator=(const per_thread&) = delete;
+
+  ~per_thread() {
+    if (generation_) per_thread_registry::instance().remove(id_);
+  }
+
+  // The calling thread's value, if it has bound one.
+  bool find(T& value) const {
+    const auto& bindings = per_thread_registry::thread_bindings();
+    if (id_ >= bindings.size() || bindings[id_].generation != generation_)
+      return false;
+    value = from_word(bindings[id_].value, std::is_pointer<T>());
+    return true;
+  }
+
+  void bind(T value) {
+    auto& bindings = per_thread_registry::thread_bindings();
+    if (bindings.size() <= id_) bindings.resize(id_ + 1);
+    bindings[id_] = { generation_, to_word(value, std::is_pointer<T>()) };
+  }
+};
+
+} // namespace detail
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_PER_THREAD_HPP_
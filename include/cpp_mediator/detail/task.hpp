@@ -0,0 +1,143 @@
+#ifndef HOLDEN_DETAIL_TASK_HPP_
+#define HOLDEN_DETAIL_TASK_HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace holden {
+namespace detail {
+
+// A move-only `void()` callable that keeps small functors in an inline
+// buffer, so queueing one does not touch the heap. Functors that do not fit,
+// are over-aligned, or may throw on move are boxed on the heap instead -
+// unless HOLDEN_MEDIATOR_NO_HEAP is defined, in which case they do not
+// compile.
+template <std::size_t InlineSize>
+class basic_task {
+  struct ops {
+    void (*invoke)(void* storage);
+    void (*relocate)(void* to, void* from);
+    void (*destroy)(void* storage);
+  };
+
+  template <typename F>
+  using fits_inline = std::integral_constant<bool,
+      sizeof(F) <= InlineSize &&
+      alignof(F) <= alignof(std::max_align_t) &&
+      std::is_nothrow_move_constructible<F>::value>;
+
+  template <typename F>
+  struct inline_ops {
+    static F& get(void* s) { return *static_cast<F*>(s); }
+    static void invoke(void* s) { get(s)(); }
+    static void relocate(void* to, void* from) {
+      ::new (to) F(std::move(get(from)));
+      get(from).~F();
+    }
+    static void destroy(void* s) { get(s).~F(); }
+  };
+
+  template <typename F>
+  struct boxed_ops {
+    static F*& get(void* s) { return *static_cast<F**>(s); }
+    static void invoke(void* s) { (*get(s))(); }
+    static void relocate(void* to, void* from) {
+      ::new (to) F*(get(from));
+    }
+    static void destroy(void* s) { delete get(s); }
+  };
+
+  template <typename F>
+  static const ops* ops_for(std::true_type) {
+    static constexpr ops o = { &inline_ops<F>::invoke,
+      &inline_ops<F>::relocate, &inline_ops<F>::destroy };
+    return &o;
+  }
+
+  template <typename F>
+  static const ops* ops_for(std::false_type) {
+    static constexpr ops o = { &boxed_ops<F>::invoke,
+      &boxed_ops<F>::relocate, &boxed_ops<F>::destroy };
+    return &o;
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[InlineSize];
+  const ops* ops_ = nullptr;
+
+ public:
+  static_assert(InlineSize >= sizeof(void*),
+                "a task must at least hold a pointer to a boxed functor");
+
+  static constexpr std::size_t inline_size = InlineSize;
+
+  template <typename F>
+  static constexpr bool stores_inline() {
+    return fits_inline<std::decay_t<F>>::value;
+  }
+
+  basic_task() = default;
+
+  template <typename F, typename = std::enable_if_t<
+      !std::is_same<std::decay_t<F>, basic_task>::value>>
+  basic_task(F&& f) {
+    using functor_t = std::decay_t<F>;
+    emplace<functor_t>(fits_inline<functor_t>(), std::forward<F>(f));
+  }
+
+  basic_task(basic_task&& other) noexcept { take(other); }
+
+  basic_task& operator=(basic_task&& other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  ~basic_task() { reset(); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+
+  void operator()() { ops_->invoke(storage_); }
+
+  void reset() {
+    if (ops_) ops_->destroy(storage_);
+    ops_ = nullptr;
+  }
+
+ private:
+  template <typename F, typename Arg>
+  void emplace(std::true_type inline_tag, Arg&& f) {
+    ::new (static_cast<void*>(storage_)) F(std::forward<Arg>(f));
+    ops_ = ops_for<F>(inline_tag);
+  }
+
+  template <typename F, typename Arg>
+  void emplace(std::false_type boxed_tag, Arg&& f) {
+#if defined(HOLDEN_MEDIATOR_NO_HEAP)
+    static_assert(sizeof(F) == 0,
+                  "functor does not fit a task inline and "
+                  "HOLDEN_MEDIATOR_NO_HEAP forbids boxing it on the heap");
+#endif
+    ::new (static_cast<void*>(storage_)) F*(new F(std::forward<Arg>(f)));
+    ops_ = ops_for<F>(boxed_tag);
+  }
+
+  void take(basic_task& other) {
+    if (other.ops_) {
+      other.ops_->relocate(storage_, other.storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+};
+
+// Sized so a task fills one cache line on common 64-bit targets.
+using task = basic_task<48>;
+
+} // namespace detail
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_TASK_HPP_
@@ -0,0 +1,101 @@
+#ifndef HOLDEN_DETAIL_WIRE_HPP_
+#define HOLDEN_DETAIL_WIRE_HPP_
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace holden {
+namespace detail {
+
+// Helpers for shipping requests and responses to another process as raw
+// bytes. Only trivially copyable types qualify: they are encoded by memcpy
+// and identified on the wire by their position in the list of request types
+// a channel was declared with.
+
+template <typename T, typename... Ts>
+struct index_of;
+template <typename T, typename... Ts>
+struct index_of<T, T, Ts...> : std::integral_constant<std::size_t, 0> {};
+template <typename T, typename U, typename... Ts>
+struct index_of<T, U, Ts...>
+  : std::integral_constant<std::size_t, 1 + index_of<T, Ts...>::value> {};
+
+template <typename T>
+struct wire_size : std::integral_constant<std::size_t, sizeof(T)> {};
+template <>
+struct wire_size<void> : std::integral_constant<std::size_t, 0> {};
+
+template <std::size_t... Ns>
+struct max_of;
+template <>
+struct max_of<> : std::integral_constant<std::size_t, 0> {};
+template <std::size_t N, std::size_t... Ns>
+struct max_of<N, Ns...> : std::integral_constant<std::size_t,
+    (N > max_of<Ns...>::value ? N : max_of<Ns...>::value)> {};
+
+// The largest request or response among `Requests`, in bytes.
+template <typename... Requests>
+using max_payload_size = max_of<wire_size<Requests>::value...,
+    wire_size<typename Requests::response_type>::value...>;
+
+template <typename T>
+struct is_wire_safe
+  : std::integral_constant<bool, std::is_trivially_copyable<T>::value> {};
+template <>
+struct is_wire_safe<void> : std::true_type {};
+
+template <typename TRequest>
+struct check_wire_safe {
+  static_assert(is_wire_safe<TRequest>::value,
+                "requests sent to another process must be trivially copyable");
+  static_assert(is_wire_safe<typename TRequest::response_type>::value,
+                "responses sent from another process must be trivially "
+                "copyable");
+  static constexpr bool value = true;
+};
+
+template <bool... Bs>
+struct all_of : std::true_type {};
+template <bool B, bool... Bs>
+struct all_of<B, Bs...>
+  : std::integral_constant<bool, B && all_of<Bs...>::value> {};
+
+// Decodes a value previously encoded with memcpy into suitably aligned bytes.
+template <typename T>
+T load(const void* bytes) {
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type buffer;
+  std::memcpy(&buffer, bytes, sizeof(T));
+  return *reinterpret_cast<const T*>(&buffer);
+}
+
+// Calls `handler.handle` on the request encoded in `request` and encodes the
+// response into `response`.
+template <typename TRequest, typename Handler>
+void handle_encoded(Handler& handler, const void* request, void* response,
+                    std::false_type /* void response */) {
+  const auto r = load<TRequest>(request);
+  const typename TRequest::response_type out = handler.handle(r);
+  std::memcpy(response, &out, sizeof(out));
+}
+
+template <typename TRequest, typename Handler>
+void handle_encoded(Handler& handler, const void* request, void*,
+                    std::true_type /* void response */) {
+  const auto r = load<TRequest>(request);
+  handler.handle(r);
+}
+
+template <typename TRequest, typename Handler>
+void handle_encoded(Handler& handler, const void* request, void* response) {
+  handle_encoded<TRequest>(handler, request, response,
+      std::is_void<typename TRequest::response_type>());
+}
+
+template <typename Handler>
+using encoded_handler_fn = void (*)(Handler&, const void*, void*);
+
+} // namespace detail
+} // namespace holden
+
+#endif // HOLDEN_DETAIL_WIRE_HPP_
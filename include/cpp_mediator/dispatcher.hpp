@@ -0,0 +1,362 @@
+#ifndef HOLDEN_DISPATCHER_HPP_
+#define HOLDEN_DISPATCHER_HPP_
+
+#include "detail/bounded_queue.hpp"
+#include "detail/cpu.hpp"
+#include "detail/dispatch_state.hpp"
+#include "detail/futex.hpp"
+#include "detail/task.hpp"
+#include "result.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+namespace holden {
+
+// Wait policies decide what a dispatcher's worker does while its queue is
+// empty, trading idle CPU for wake-up latency.
+
+// Sleeps on a futex as soon as the queue runs dry. Cheapest when idle, but
+// every wake-up costs the producer a syscall and the worker a reschedule.
+struct park_wait {
+  static constexpr bool may_park = true;
+
+  template <typename Ready>
+  void idle(detail::event_count& wakeup, Ready&& ready) {
+    const auto key = wakeup.prepare_wait();
+    if (ready()) wakeup.cancel_wait();
+    else wakeup.wait(key);
+  }
+};
+
+// Never sleeps. Meant for a worker pinned to an isolated core (`isolcpus`,
+// `nohz_full`), where it reacts to a request within a cache miss and
+// producers never make a syscall.
+struct busy_poll_wait {
+  static constexpr bool may_park = false;
+
+  template <typename Ready>
+  void idle(detail::event_count&, Ready&& ready) {
+    while (!ready()) detail::cpu_relax();
+  }
+};
+
+// Spins for a while before parking. The spin budget adapts: it doubles each
+// time a request shows up mid-spin and halves each time the worker had to
+// park, so bursty load is served from the spin loop and quiet periods cost
+// little CPU.
+class spin_then_park_wait {
+  std::uint32_t min_spins_;
+  std::uint32_t max_spins_;
+  std::uint32_t spins_;
+
+ public:
+  static constexpr bool may_park = true;
+
+  explicit spin_then_park_wait(std::uint32_t min_spins = 64,
+                               std::uint32_t max_spins = 1u << 16)
+    : min_spins_(min_spins), max_spins_(std::max(min_spins, max_spins)),
+      spins_(min_spins) {}
+
+  std::uint32_t spin_budget() const { return spins_; }
+
+  template <typename Ready>
+  void idle(detail::event_count& wakeup, Ready&& ready) {
+    for (std::uint32_t i = 0; i < spins_; ++i) {
+      if (ready()) {
+        spins_ = std::min(max_spins_, spins_ * 2);
+        return;
+      }
+      detail::cpu_relax();
+    }
+    spins_ = std::max(min_spins_, spins_ / 2);
+    park_wait().idle(wakeup, ready);
+  }
+};
+
+namespace detail {
+
+template <typename TResponse, typename F>
+void fulfil(std::promise<TResponse>& p, F&& f) {
+  try {
+    p.set_value(f());
+  } catch (...) {
+    p.set_exception(std::current_exception());
+  }
+}
+
+template <typename F>
+void fulfil(std::promise<void>& p, F&& f) {
+  try {
+    f();
+    p.set_value();
+  } catch (...) {
+    p.set_exception(std::current_exception());
+  }
+}
+
+} // namespace detail
+
+// Runs a mediator's handlers on a dedicated worker thread. Requests are
+// copied into a fixed-capacity lock-free queue; `WaitPolicy` decides how the
+// worker waits for them. Handlers only ever run on the worker, so they need
+// no synchronisation of their own as long as all sends go through here.
+//
+// Sends made by a handler through its own dispatcher - i.e. on the worker -
+// are run inline rather than queued: queueing would cost a pointless hop,
+// and waiting on the result would deadlock the worker. Such a nested send
+// therefore runs ahead of requests queued before it.
+//
+// Each queue slot stores a queued send inline in `SlotSize` bytes; a send
+// whose request and continuation do not fit is boxed on the heap instead.
+template <typename Mediator,
+          typename WaitPolicy = park_wait,
+          std::size_t Capacity = 1024,
+          std::size_t SlotSize = detail::task::inline_size>
+class dispatcher {
+  using task_t = detail::basic_task<SlotSize>;
+
+  // A queued `send_then`: the request and its continuation, by value.
+  template <typename TRequest, typename Continuation>
+  struct then_job {
+    dispatcher* self;
+    TRequest request;
+    Continuation continuation;
+
+    void operator()() {
+      continuation(detail::capture(
+          [this] { return self->mediator_.send(request); }));
+    }
+  };
+
+  detail::bounded_queue<task_t, Capacity> queue_;
+  detail::event_count wakeup_;
+  std::atomic<bool> stopping_{false};
+  Mediator& mediator_;
+  WaitPolicy policy_;
+  std::thread worker_;
+
+ public:
+  static constexpr int any_cpu = -1;
+
+  // Starts the worker. When `cpu` is given the worker is pinned to it, and
+  // `std::system_error` is thrown if that is not possible.
+  explicit dispatcher(Mediator& m, WaitPolicy policy = WaitPolicy(),
+                      int cpu = any_cpu)
+    : mediator_(m), policy_(std::move(policy)),
+      worker_([this] { run(); }) {
+    if (cpu != any_cpu && !detail::pin_thread_to_cpu(worker_, cpu)) {
+      stop();
+      throw std::system_error(
+          std::make_error_code(std::errc::invalid_argument),
+          "cannot pin dispatcher worker to the requested cpu");
+    }
+  }
+
+  dispatcher(const dispatcher&) = delete;
+  dispatcher& operator=(const dispatcher&) = delete;
+
+  // Runs every request already queued, then stops the worker.
+  ~dispatcher() { stop(); }
+
+  // Queues `r` for the worker. The future receives the handler's response,
+  // or the exception it threw.
+  template <typename TRequest>
+  auto send_async(TRequest r)
+  -> std::future<typename TRequest::response_type> {
+    std::promise<typename TRequest::response_type> p;
+    auto f = p.get_future();
+    if (on_worker()) {
+      detail::dispatch_frame frame(detail::this_thread_dispatch());
+      detail::fulfil(p, [&] { return mediator_.send(r); });
+      return f;
+    }
+    post([this, r = std::move(r), p = std::move(p)]() mutable {
+      detail::fulfil(p, [&] { return mediator_.send(r); });
+    });
+    return f;
+  }
+
+  // Queues `r` for the worker, then hands the outcome to `callback` as a
+  // `result<response_type>` on whichever thread drains `completions` -
+  // typically an event loop polling `completions.native_handle()`.
+  template <typename TRequest, typename CompletionQueue, typename Callback>
+  void send_async(TRequest r, CompletionQueue& completions, Callback callback) {
+    if (on_worker()) {
+      detail::dispatch_frame frame(detail::this_thread_dispatch());
+      auto outcome = detail::capture([&] { return mediator_.send(r); });
+      completions.post([callback = std::move(callback),
+                        outcome = std::move(outcome)]() mutable {
+        callback(std::move(outcome));
+      });
+      return;
+    }
+    post([this, r = std::move(r), &completions,
+          callback = std::move(callback)]() mutable {
+      auto outcome = detail::capture([&] { return mediator_.send(r); });
+      completions.post([callback = std::move(callback),
+                        outcome = std::move(outcome)]() mutable {
+        callback(std::move(outcome));
+      });
+    });
+  }
+
+  // Queues `r` for the worker and, right after handling it, calls
+  // `continuation(result<response_type>)` there. The request and the
+  // continuation are stored in the queue slot itself (see `SlotSize`), so
+  // unlike `send_async` this needs no shared state, allocation or
+  // synchronisation beyond the queue.
+  template <typename TRequest, typename Continuation>
+  void send_then(TRequest r, Continuation continuation) {
+    then_job<TRequest, Continuation> job{this, std::move(r),
+                                         std::move(continuation)};
+    if (on_worker()) {
+      detail::dispatch_frame frame(detail::this_thread_dispatch());
+      return job();
+    }
+    post(std::move(job));
+  }
+
+  // As `send_then`, but never waits for room in the queue: returns false,
+  // dropping the send, if the queue is full. Refuses at compile time a send
+  // that would have to be boxed on the heap. With a wait policy that never
+  // parks, this allocates nothing, takes no lock and makes no syscall (see
+  // realtime.hpp).
+  template <typename TRequest, typename Continuation>
+  bool try_send_then(TRequest r, Continuation continuation) {
+    static_assert(sends_inline<TRequest, Continuation>(),
+                  "request and continuation do not fit a queue slot; "
+                  "raise the dispatcher's SlotSize");
+    then_job<TRequest, Continuation> job{this, std::move(r),
+                                         std::move(continuation)};
+    if (on_worker()) {
+      detail::dispatch_frame frame(detail::this_thread_dispatch());
+      job();
+      return true;
+    }
+    if (!queue_.try_push(task_t(std::move(job)))) return false;
+    if (WaitPolicy::may_park) wakeup_.notify_one();
+    return true;
+  }
+
+  // Queues `f()` to run on the worker, like a send with no request.
+  template <typename F>
+  void execute(F f) {
+    if (on_worker()) {
+      detail::dispatch_frame frame(detail::this_thread_dispatch());
+      return f();
+    }
+    post(std::move(f));
+  }
+
+  // The mediator handlers are looked up in; only send through it from code
+  // running on the worker.
+  Mediator& mediator() { return mediator_; }
+
+  // Whether `send_then` with these types fits a queue slot without boxing.
+  template <typename TRequest, typename Continuation>
+  static constexpr bool sends_inline() {
+    return task_t::template stores_inline<then_job<TRequest, Continuation>>();
+  }
+
+  // Sends `r` through the worker and waits for the response.
+  template <typename TRequest>
+  auto send(const TRequest& r) -> typename TRequest::response_type {
+    if (on_worker()) {
+      detail::dispatch_frame frame(detail::this_thread_dispatch());
+      return mediator_.send(r);
+    }
+    return send_async(r).get();
+  }
+
+  // A scheduler (see execution.hpp) whose senders complete on the worker,
+  // so `starts_on(d.get_scheduler(), m.schedule_send(r))` sends `r` there.
+  // Scheduling queues a pointer to the operation state; nothing is
+  // allocated.
+  class scheduler {
+    template <typename Receiver>
+    struct operation {
+      dispatcher* target;
+      Receiver receiver;
+
+      void start() noexcept {
+        target->post([this] { receiver.set_value(); });
+      }
+    };
+
+    dispatcher* dispatcher_;
+
+   public:
+    struct sender {
+      using value_type = void;
+      dispatcher* target;
+
+      template <typename Receiver>
+      operation<std::decay_t<Receiver>> connect(Receiver&& r) const {
+        return { target, std::forward<Receiver>(r) };
+      }
+    };
+
+    explicit scheduler(dispatcher* d) : dispatcher_(d) {}
+
+    sender schedule() const { return { dispatcher_ }; }
+
+    bool operator==(const scheduler& other) const {
+      return dispatcher_ == other.dispatcher_;
+    }
+    bool operator!=(const scheduler& other) const { return !(*this == other); }
+  };
+
+  scheduler get_scheduler() { return scheduler(this); }
+
+  // True when called from a handler running on this dispatcher's worker.
+  bool on_worker() const {
+    return detail::this_thread_dispatch().worker_of == this;
+  }
+
+ private:
+  void post(task_t t) {
+    for (unsigned attempt = 0; !queue_.try_push(std::move(t)); ++attempt) {
+      // Queue full: back off until the worker catches up.
+      if (attempt < 64) detail::cpu_relax();
+      else std::this_thread::yield();
+    }
+    if (WaitPolicy::may_park) wakeup_.notify_one();
+  }
+
+  void run() {
+    auto& state = detail::this_thread_dispatch();
+    state.worker_of = this;
+    task_t t;
+    for (;;) {
+      if (queue_.try_pop(t)) {
+        detail::dispatch_frame frame(state);
+        t();
+        t.reset();
+        continue;
+      }
+      if (stopping_.load(std::memory_order_acquire) && queue_.empty()) return;
+      policy_.idle(wakeup_, [this] {
+        return !queue_.empty() || stopping_.load(std::memory_order_acquire);
+      });
+    }
+  }
+
+  void stop() {
+    if (!worker_.joinable()) return;
+    stopping_.store(true, std::memory_order_release);
+    wakeup_.notify_one();
+    worker_.join();
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_DISPATCHER_HPP_
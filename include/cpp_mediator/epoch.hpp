@@ -0,0 +1,270 @@
+#ifndef HOLDEN_EPOCH_HPP_
+#define HOLDEN_EPOCH_HPP_
+
+#include "detail/futex.hpp"
+#include "detail/per_thread.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace holden {
+
+class epoch_domain;
+
+// Keeps everything retired in its domain from being freed while it lives.
+// Obtained from `epoch_domain::pin()`; pins nest, and a guard may be moved
+// to and released on another thread.
+class epoch_guard {
+  friend class epoch_domain;
+
+  std::atomic<std::uint64_t>* pin_ = nullptr;
+
+  explicit epoch_guard(std::atomic<std::uint64_t>* pin) : pin_(pin) {}
+
+ public:
+  epoch_guard() = default;
+  epoch_guard(epoch_guard&& other) noexcept : pin_(other.pin_) {
+    other.pin_ = nullptr;
+  }
+  epoch_guard& operator=(epoch_guard&& other) noexcept {
+    std::swap(pin_, other.pin_);
+    return *this;
+  }
+  ~epoch_guard() { reset(); }
+
+  bool pinned() const { return pin_ != nullptr; }
+
+  void reset() {
+    if (pin_) pin_->fetch_sub(1, std::memory_order_release);
+    pin_ = nullptr;
+  }
+};
+
+// Epoch-based reclamation: readers pin the domain around their reads, and
+// writers hand what they unlink to `retire` instead of freeing it. A retired
+// object is freed once every reader pinned before it was retired has let
+// go, so readers never take a lock or touch a reference count, and writers
+// never wait for readers.
+//
+// Each thread pins through its own record, taken on its first pin and
+// recycled when the thread exits, so there are only ever as many records
+// as threads pinning at once. Destroying the domain frees whatever is
+// still retired; no guard may outlive it.
+class epoch_domain {
+  // A record packs the epoch its thread pinned at (high bits) with how many
+  // guards hold it (low bits); it is idle while the count is zero.
+  static constexpr unsigned depth_bits = 16;
+  static constexpr std::uint64_t depth_mask = (1u << depth_bits) - 1;
+
+  struct retired {
+    std::uint64_t epoch;
+    void* object;
+    void (*destroy)(void*);
+  };
+
+  using record_t = std::atomic<std::uint64_t>;
+
+  const std::size_t batch_;
+  std::atomic<std::uint64_t> epoch_{1};
+  std::mutex mutex_;
+  std::deque<record_t> records_;
+  std::vector<record_t*> free_records_;
+  std::vector<retired> retired_;
+  detail::per_thread<record_t*> locals_ =
+    detail::per_thread<record_t*>::make<
+      epoch_domain, &epoch_domain::thread_exited>(this);
+
+ public:
+  // Retiring tries to reclaim once `batch` objects are waiting.
+  explicit epoch_domain(std::size_t batch = 64) : batch_(batch) {}
+
+  epoch_domain(const epoch_domain&) = delete;
+  epoch_domain& operator=(const epoch_domain&) = delete;
+
+  ~epoch_domain() {
+    for (auto& r : retired_) r.destroy(r.object);
+  }
+
+  epoch_guard pin() {
+    record_t& record = local_record();
+    std::uint64_t word = record.load(std::memory_order_relaxed);
+    std::uint64_t pinned;
+    do {
+      assert((word & depth_mask) != depth_mask && "epoch pins nested too deep");
+      pinned = (word & depth_mask)
+          ? word + 1
+          : (epoch_.load(std::memory_order_acquire) << depth_bits) | 1;
+    } while (!record.compare_exchange_weak(word, pinned,
+                                           std::memory_order_seq_cst,
+                                           std::memory_order_relaxed));
+    // Publish the pin before anything the guard protects is read.
+#if !defined(HOLDEN_MEDIATOR_TSAN)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+    return epoch_guard(&record);
+  }
+
+  // Frees `object` with `delete` once no reader can still see it. It must
+  // already be unreachable to readers that pin from now on.
+  template <typename T>
+  void retire(T* object) {
+    retire(const_cast<void*>(static_cast<const void*>(object)),
+           [](void* p) { delete static_cast<T*>(p); });
+  }
+
+  void retire(void* object, void (*destroy)(void*)) {
+    if (!object) return;
+    const auto epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    std::lock_guard<std::mutex> lock(mutex_);
+    retired_.push_back(retired{epoch, object, destroy});
+    if (retired_.size() >= batch_) reclaim_locked();
+  }
+
+  // Frees what no pinned reader can see; returns how many objects.
+  std::size_t reclaim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reclaim_locked();
+  }
+
+  // Retired objects not yet freed.
+  std::size_t pending() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return retired_.size();
+  }
+
+ private:
+  record_t& local_record() {
+    record_t* local;
+    if (locals_.find(local)) return *local;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_records_.empty()) {
+        records_.emplace_back(0);
+        local = &records_.back();
+      } else {
+        local = free_records_.back();
+        free_records_.pop_back();
+      }
+    }
+    locals_.bind(local);
+    return *local;
+  }
+
+  // A guard moved to another thread may still hold an exited thread's
+  // record; the next thread to take it then nests its pins into that one.
+  static void thread_exited(epoch_domain* self, record_t* record) {
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    self->free_records_.push_back(record);
+  }
+
+  std::size_t reclaim_locked() {
+#if !defined(HOLDEN_MEDIATOR_TSAN)
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+#endif
+    // Readers pinned at epoch `e` may hold anything retired at `e` or later.
+    std::uint64_t oldest = UINT64_MAX;
+    for (auto& record : records_) {
+      const auto word = record.load(std::memory_order_seq_cst);
+      if (word & depth_mask) oldest = std::min(oldest, word >> depth_bits);
+    }
+
+    std::size_t freed = 0;
+    auto keep = retired_.begin();
+    for (auto& r : retired_) {
+      if (r.epoch < oldest) {
+        r.destroy(r.object);
+        ++freed;
+      } else {
+        *keep++ = r;
+      }
+    }
+    retired_.erase(keep, retired_.end());
+    return freed;
+  }
+};
+
+// A read-only view of `size()` consecutive `T`s owned by someone else,
+// pinned in an epoch domain for as long as the view lives. Handlers return
+// one to hand out their state without copying it:
+//
+//   epoch_view<Row> handle(const GetRow& q) {
+//     auto table = table_.view();
+//     return std::move(table).project(&table->rows[q.index]);
+//   }
+//
+// The caller must drop the view promptly: nothing retired in the domain
+// after it was pinned is freed before then.
+template <typename T>
+class epoch_view {
+  epoch_guard guard_;
+  const T* data_ = nullptr;
+  std::size_t size_ = 0;
+
+ public:
+  epoch_view() = default;
+  epoch_view(epoch_guard guard, const T* data, std::size_t size = 1)
+    : guard_(std::move(guard)), data_(data), size_(data ? size : 0) {}
+
+  epoch_view(epoch_view&&) = default;
+  epoch_view& operator=(epoch_view&&) = default;
+
+  const T* get() const { return data_; }
+  const T& operator*() const { return *data_; }
+  const T* operator->() const { return data_; }
+  const T& operator[](std::size_t i) const { return data_[i]; }
+
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  explicit operator bool() const { return data_ != nullptr; }
+
+  // A view of part of what this one protects, taking over its pin.
+  template <typename U>
+  epoch_view<U> project(const U* data, std::size_t size = 1) && {
+    return epoch_view<U>(std::move(guard_), data, size);
+  }
+};
+
+// A pointer to handler state that readers view in place while writers
+// replace it; the replaced object is retired in the domain.
+template <typename T>
+class epoch_ptr {
+  epoch_domain& domain_;
+  std::atomic<T*> current_;
+
+ public:
+  explicit epoch_ptr(epoch_domain& domain, std::unique_ptr<T> initial = nullptr)
+    : domain_(domain), current_(initial.release()) {}
+
+  epoch_ptr(const epoch_ptr&) = delete;
+  epoch_ptr& operator=(const epoch_ptr&) = delete;
+
+  ~epoch_ptr() { domain_.retire(current_.load(std::memory_order_relaxed)); }
+
+  // Pins the domain and views the current object.
+  epoch_view<T> view() const {
+    auto guard = domain_.pin();
+    return epoch_view<T>(std::move(guard),
+                         current_.load(std::memory_order_acquire));
+  }
+
+  // Publishes `next` and retires the object it replaces.
+  void reset(std::unique_ptr<T> next) {
+    domain_.retire(current_.exchange(next.release(),
+                                     std::memory_order_acq_rel));
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_EPOCH_HPP_
@@ -0,0 +1,449 @@
+#ifndef HOLDEN_EXECUTION_HPP_
+#define HOLDEN_EXECUTION_HPP_
+
+#include "detail/futex.hpp"
+#include "mediator.hpp"
+#include "result.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// A small sender/receiver vocabulary in the style of P2300, sized to what
+// mediator sends need.
+//
+// A *sender* describes work that has not started. It names what it
+// completes with as `value_type` (possibly void) and has
+// `connect(receiver)`, returning an *operation state* with `start()`. An
+// operation state must not move once started.
+//
+// A *receiver* is told how the work ended through exactly one of
+// `set_value(v)` (or `set_value()` for void), `set_error(std::exception_ptr)`
+// and `set_stopped()`.
+//
+// A *scheduler* has `schedule()`, returning a void sender that completes on
+// the scheduler's execution context.
+//
+// Everything is composed by value: no type erasure, no allocation. A
+// pipeline of `schedule_send`s and `then`s started inline boils down to the
+// same calls a synchronous `send` makes.
+
+namespace holden {
+namespace execution {
+
+template <typename Sender>
+using value_type_of = typename std::decay_t<Sender>::value_type;
+
+template <typename Sender, typename Receiver>
+using connect_result_t = decltype(std::declval<Sender>().connect(
+    std::declval<Receiver>()));
+
+// Thrown by `sync_wait` when the work completed with `set_stopped`.
+class operation_stopped : public std::runtime_error {
+ public:
+  operation_stopped() : std::runtime_error("operation stopped") {}
+};
+
+namespace detail {
+
+// Storage for a value that arrives later, without requiring T to be
+// default constructible.
+template <typename T>
+class value_slot {
+  alignas(T) unsigned char bytes_[sizeof(T)];
+  bool engaged_ = false;
+
+ public:
+  value_slot() = default;
+  value_slot(const value_slot&) = delete;
+  value_slot& operator=(const value_slot&) = delete;
+  ~value_slot() {
+    if (engaged_) get().~T();
+  }
+
+  template <typename... Vs>
+  void emplace(Vs&&... vs) {
+    ::new (static_cast<void*>(bytes_)) T(std::forward<Vs>(vs)...);
+    engaged_ = true;
+  }
+
+  T& get() { return *reinterpret_cast<T*>(bytes_); }
+  T take() { return std::move(get()); }
+
+  std::tuple<T> take_tuple() { return std::tuple<T>(take()); }
+};
+
+template <>
+class value_slot<void> {
+ public:
+  void emplace() {}
+  void take() {}
+  std::tuple<> take_tuple() { return {}; }
+};
+
+// Storage for an operation state that can only be connected once the
+// parent operation has stopped moving, i.e. from `start()`.
+template <typename Operation>
+class deferred_operation {
+  alignas(Operation) unsigned char bytes_[sizeof(Operation)];
+  bool engaged_ = false;
+
+ public:
+  deferred_operation() = default;
+  deferred_operation(deferred_operation&&) noexcept {}
+  ~deferred_operation() {
+    if (engaged_) reinterpret_cast<Operation*>(bytes_)->~Operation();
+  }
+
+  // Constructs the operation from `connect()`, a callable returning it.
+  template <typename Connect>
+  Operation& emplace(Connect&& connect) {
+    auto* op = ::new (static_cast<void*>(bytes_)) Operation(connect());
+    engaged_ = true;
+    return *op;
+  }
+};
+
+// -- then -------------------------------------------------------------------
+
+template <typename F, typename T>
+struct then_result {
+  using type = decltype(std::declval<F&>()(std::declval<T>()));
+};
+template <typename F>
+struct then_result<F, void> {
+  using type = decltype(std::declval<F&>()());
+};
+
+template <typename Receiver, typename F>
+struct then_receiver {
+  Receiver next;
+  F f;
+
+  template <typename... Vs>
+  void set_value(Vs&&... vs) {
+    ::holden::detail::complete(next, ::holden::detail::capture(
+        [&] { return f(std::forward<Vs>(vs)...); }));
+  }
+  void set_error(std::exception_ptr e) { next.set_error(std::move(e)); }
+  void set_stopped() { next.set_stopped(); }
+};
+
+template <typename Sender, typename F>
+class then_sender {
+  Sender sender_;
+  F f_;
+
+ public:
+  using value_type = typename then_result<F, value_type_of<Sender>>::type;
+
+  then_sender(Sender s, F f) : sender_(std::move(s)), f_(std::move(f)) {}
+
+  template <typename Receiver>
+  connect_result_t<Sender, then_receiver<std::decay_t<Receiver>, F>>
+  connect(Receiver&& r) && {
+    return std::move(sender_).connect(then_receiver<std::decay_t<Receiver>, F>{
+        std::forward<Receiver>(r), std::move(f_)});
+  }
+
+  template <typename Receiver>
+  connect_result_t<const Sender&, then_receiver<std::decay_t<Receiver>, F>>
+  connect(Receiver&& r) const & {
+    return sender_.connect(then_receiver<std::decay_t<Receiver>, F>{
+        std::forward<Receiver>(r), f_});
+  }
+};
+
+// -- when_all ---------------------------------------------------------------
+
+template <typename Receiver, typename... Senders>
+class when_all_operation {
+  template <std::size_t I>
+  struct child_receiver {
+    when_all_operation* parent;
+
+    template <typename... Vs>
+    void set_value(Vs&&... vs) {
+      std::get<I>(parent->values_).emplace(std::forward<Vs>(vs)...);
+      parent->arrive();
+    }
+    void set_error(std::exception_ptr e) {
+      parent->fail(state_error, std::move(e));
+    }
+    void set_stopped() { parent->fail(state_stopped, nullptr); }
+  };
+
+  template <typename Indices>
+  struct children_of;
+  template <std::size_t... Is>
+  struct children_of<std::index_sequence<Is...>> {
+    using type = std::tuple<connect_result_t<Senders, child_receiver<Is>>...>;
+  };
+  using indices = std::index_sequence_for<Senders...>;
+  using children_t = typename children_of<indices>::type;
+
+  enum : int { state_running, state_error, state_stopped };
+
+  std::tuple<Senders...> senders_;
+  Receiver receiver_;
+  std::tuple<value_slot<value_type_of<Senders>>...> values_;
+  std::atomic<std::size_t> remaining_{sizeof...(Senders)};
+  std::atomic<int> state_{state_running};
+  std::exception_ptr error_;
+  deferred_operation<children_t> children_;
+
+ public:
+  when_all_operation(std::tuple<Senders...> senders, Receiver r)
+    : senders_(std::move(senders)), receiver_(std::move(r)) {}
+
+  when_all_operation(when_all_operation&& other)
+    : senders_(std::move(other.senders_)),
+      receiver_(std::move(other.receiver_)) {}
+
+  void start() noexcept {
+    if (sizeof...(Senders) == 0) return finish();
+    start(indices());
+  }
+
+ private:
+  template <std::size_t... Is>
+  void start(std::index_sequence<Is...>) {
+    auto& children = children_.emplace([this] {
+      return children_t(std::move(std::get<Is>(senders_)).connect(
+          child_receiver<Is>{this})...);
+    });
+    int ignored[] = { 0, (std::get<Is>(children).start(), 0)... };
+    (void)ignored;
+  }
+
+  void fail(int state, std::exception_ptr e) {
+    int expected = state_running;
+    if (state_.compare_exchange_strong(expected, state)) error_ = std::move(e);
+    arrive();
+  }
+
+  void arrive() {
+    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) finish();
+  }
+
+  void finish() {
+    switch (state_.load(std::memory_order_acquire)) {
+      case state_error: return receiver_.set_error(error_);
+      case state_stopped: return receiver_.set_stopped();
+      default: return finish_values(indices());
+    }
+  }
+
+  template <std::size_t... Is>
+  void finish_values(std::index_sequence<Is...>) {
+    receiver_.set_value(
+        std::tuple_cat(std::get<Is>(values_).take_tuple()...));
+  }
+};
+
+template <typename... Senders>
+class when_all_sender {
+  std::tuple<Senders...> senders_;
+
+ public:
+  using value_type = decltype(std::tuple_cat(
+      std::declval<value_slot<value_type_of<Senders>>&>().take_tuple()...));
+
+  explicit when_all_sender(Senders... senders)
+    : senders_(std::move(senders)...) {}
+
+  template <typename Receiver>
+  when_all_operation<std::decay_t<Receiver>, Senders...>
+  connect(Receiver&& r) && {
+    return { std::move(senders_), std::forward<Receiver>(r) };
+  }
+
+  template <typename Receiver>
+  when_all_operation<std::decay_t<Receiver>, Senders...>
+  connect(Receiver&& r) const & {
+    return { senders_, std::forward<Receiver>(r) };
+  }
+};
+
+// -- starts_on --------------------------------------------------------------
+
+template <typename Scheduler, typename Sender, typename Receiver>
+class starts_on_operation {
+  struct scheduled_receiver {
+    starts_on_operation* self;
+    void set_value() {
+      self->work_.emplace([this] {
+        return std::move(self->sender_).connect(std::move(self->receiver_));
+      }).start();
+    }
+    void set_error(std::exception_ptr e) {
+      self->receiver_.set_error(std::move(e));
+    }
+    void set_stopped() { self->receiver_.set_stopped(); }
+  };
+
+  using schedule_sender_t = decltype(std::declval<Scheduler&>().schedule());
+
+  Scheduler scheduler_;
+  Sender sender_;
+  Receiver receiver_;
+  deferred_operation<connect_result_t<schedule_sender_t, scheduled_receiver>>
+    schedule_;
+  deferred_operation<connect_result_t<Sender, Receiver>> work_;
+
+ public:
+  starts_on_operation(Scheduler sch, Sender s, Receiver r)
+    : scheduler_(std::move(sch)), sender_(std::move(s)),
+      receiver_(std::move(r)) {}
+
+  void start() noexcept {
+    schedule_.emplace([this] {
+      return scheduler_.schedule().connect(scheduled_receiver{this});
+    }).start();
+  }
+};
+
+template <typename Scheduler, typename Sender>
+class starts_on_sender {
+  Scheduler scheduler_;
+  Sender sender_;
+
+ public:
+  using value_type = value_type_of<Sender>;
+
+  starts_on_sender(Scheduler sch, Sender s)
+    : scheduler_(std::move(sch)), sender_(std::move(s)) {}
+
+  template <typename Receiver>
+  starts_on_operation<Scheduler, Sender, std::decay_t<Receiver>>
+  connect(Receiver&& r) && {
+    return { std::move(scheduler_), std::move(sender_),
+             std::forward<Receiver>(r) };
+  }
+
+  template <typename Receiver>
+  starts_on_operation<Scheduler, Sender, std::decay_t<Receiver>>
+  connect(Receiver&& r) const & {
+    return { scheduler_, sender_, std::forward<Receiver>(r) };
+  }
+};
+
+// -- sync_wait --------------------------------------------------------------
+
+template <typename T>
+struct sync_wait_state {
+  enum : std::uint32_t { pending, done, pending_sleeper };
+
+  value_slot<T> value;
+  std::exception_ptr error;
+  bool stopped = false;
+  std::atomic<std::uint32_t> state{pending};
+
+  // Work that completes inline never reaches the futex.
+  void signal() {
+    if (state.exchange(done, std::memory_order_acq_rel) == pending_sleeper)
+      ::holden::detail::futex_wake(state, 1);
+  }
+
+  void wait() {
+    std::uint32_t expected = pending;
+    if (!state.compare_exchange_strong(expected, pending_sleeper,
+                                       std::memory_order_acq_rel))
+      return;
+    while (state.load(std::memory_order_acquire) != done)
+      ::holden::detail::futex_wait(state, pending_sleeper);
+  }
+};
+
+template <typename T>
+struct sync_wait_receiver {
+  sync_wait_state<T>* state;
+
+  template <typename... Vs>
+  void set_value(Vs&&... vs) {
+    state->value.emplace(std::forward<Vs>(vs)...);
+    state->signal();
+  }
+  void set_error(std::exception_ptr e) {
+    state->error = std::move(e);
+    state->signal();
+  }
+  void set_stopped() {
+    state->stopped = true;
+    state->signal();
+  }
+};
+
+} // namespace detail
+
+// Completes with `f(value)` (or `f()`); an exception thrown by `f` becomes
+// the error.
+template <typename Sender, typename F>
+detail::then_sender<std::decay_t<Sender>, std::decay_t<F>>
+then(Sender&& s, F&& f) {
+  return { std::forward<Sender>(s), std::forward<F>(f) };
+}
+
+// Starts every sender and completes once all have, with a tuple of their
+// non-void values in order. If any fails, completes with the first error
+// (or stopped) once the rest have finished.
+template <typename... Senders>
+detail::when_all_sender<std::decay_t<Senders>...>
+when_all(Senders&&... senders) {
+  return detail::when_all_sender<std::decay_t<Senders>...>(
+      std::forward<Senders>(senders)...);
+}
+
+// Runs `s` on `scheduler`'s execution context.
+template <typename Scheduler, typename Sender>
+detail::starts_on_sender<std::decay_t<Scheduler>, std::decay_t<Sender>>
+starts_on(Scheduler&& scheduler, Sender&& s) {
+  return { std::forward<Scheduler>(scheduler), std::forward<Sender>(s) };
+}
+
+// Completes immediately, on whichever thread starts it.
+class inline_scheduler {
+  template <typename Receiver>
+  struct operation {
+    Receiver receiver;
+    void start() noexcept { receiver.set_value(); }
+  };
+
+ public:
+  struct sender {
+    using value_type = void;
+    template <typename Receiver>
+    operation<std::decay_t<Receiver>> connect(Receiver&& r) const {
+      return { std::forward<Receiver>(r) };
+    }
+  };
+
+  sender schedule() const { return {}; }
+};
+
+// Starts `s` and blocks the calling thread until it completes. Returns the
+// value, rethrows the error, or throws `operation_stopped`.
+template <typename Sender>
+value_type_of<Sender> sync_wait(Sender&& s) {
+  using value_t = value_type_of<Sender>;
+  detail::sync_wait_state<value_t> state;
+  auto op = std::forward<Sender>(s).connect(
+      detail::sync_wait_receiver<value_t>{&state});
+  op.start();
+  state.wait();
+
+  if (state.error) std::rethrow_exception(state.error);
+  if (state.stopped) throw operation_stopped();
+  return state.value.take();
+}
+
+} // namespace execution
+} // namespace holden
+
+#endif // HOLDEN_EXECUTION_HPP_
@@ -0,0 +1,258 @@
+#ifndef HOLDEN_FIBER_HPP_
+#define HOLDEN_FIBER_HPP_
+
+#include "detail/dispatch_state.hpp"
+#include "detail/task.hpp"
+#include "result.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <ucontext.h>
+
+namespace holden {
+
+class fiber_scheduler;
+
+namespace detail {
+
+struct fiber {
+  ucontext_t context;
+  std::unique_ptr<char[]> stack;
+  task body;
+  bool finished = false;
+  fiber_dispatch dispatch;
+};
+
+template <typename TResponse>
+struct fiber_future_state {
+  // Engaged once the handler has run.
+  std::unique_ptr<result<TResponse>> outcome;
+  fiber* waiter = nullptr;
+};
+
+} // namespace detail
+
+template <typename TResponse>
+class fiber_future;
+
+// Runs many lightweight stackful coroutines ("fibers") on the calling
+// thread. A fiber that waits on a `fiber_future` is parked and the thread
+// moves on to the next ready fiber, so handlers may block on other sends at
+// the cost of a context switch instead of an OS thread each:
+//
+//   fiber_scheduler fibers;
+//   fibers.spawn([&] {
+//     auto price = fibers.send_async(m, GetPrice{sku});  // runs on a fiber
+//     auto stock = fibers.send_async(m, GetStock{sku});
+//     use(price.get(), stock.get());                      // parks until done
+//   });
+//   fibers.run();
+//
+// Contexts are switched with ucontext. Stacks are plain heap blocks without
+// guard pages (100k mapped guard pages would exceed the kernel's map count
+// limit) and are recycled as fibers finish, so size them for the deepest
+// handler call chain.
+class fiber_scheduler {
+  std::size_t stack_size_;
+  ucontext_t scheduler_context_;
+  std::deque<detail::fiber*> ready_;
+  std::vector<std::unique_ptr<detail::fiber>> fibers_;
+  std::vector<detail::fiber*> idle_;
+  detail::fiber* running_ = nullptr;
+  std::exception_ptr failure_;
+
+  static fiber_scheduler*& current_scheduler() {
+    static thread_local fiber_scheduler* scheduler = nullptr;
+    return scheduler;
+  }
+
+ public:
+  explicit fiber_scheduler(std::size_t stack_size = 64 * 1024)
+    : stack_size_(stack_size) {}
+
+  fiber_scheduler(const fiber_scheduler&) = delete;
+  fiber_scheduler& operator=(const fiber_scheduler&) = delete;
+
+  // The scheduler running the calling fiber, or null outside any fiber.
+  static fiber_scheduler* current() { return current_scheduler(); }
+
+  // Number of fibers created so far, live or recycled.
+  std::size_t fiber_count() const { return fibers_.size(); }
+
+  // Creates a fiber that will run `f` once the scheduler gets to it.
+  template <typename F>
+  void spawn(F f) {
+    detail::fiber* fiber = acquire();
+    fiber->body = detail::task(std::move(f));
+    ready_.push_back(fiber);
+  }
+
+  // Runs `r` through `m` on a fiber of its own. The handler may itself wait
+  // on further sends.
+  template <typename Mediator, typename TRequest>
+  auto send_async(Mediator& m, TRequest r)
+  -> fiber_future<typename TRequest::response_type>;
+
+  // Runs fibers until none are left. Rethrows the first exception that
+  // escaped a fiber spawned with `spawn`.
+  void run() {
+    run_until([] { return false; });
+  }
+
+  // Called from a fiber: lets the other ready fibers run first.
+  void yield() {
+    ready_.push_back(running_);
+    suspend();
+  }
+
+ private:
+  template <typename TResponse> friend class fiber_future;
+
+  // Runs fibers until `done()` or none are ready.
+  template <typename Done>
+  void run_until(Done&& done) {
+    fiber_scheduler* outer = current_scheduler();
+    current_scheduler() = this;
+    auto& state = detail::this_thread_dispatch();
+    const auto outer_yield = state.yield_fiber;
+    void* const outer_fibers = state.fiber_scheduler;
+    while (!ready_.empty() && !done()) {
+      detail::fiber* fiber = ready_.front();
+      const std::size_t base_depth = state.depth;
+      const std::size_t base_held = state.held_count;
+      if (!state.resume(fiber->dispatch)) {
+        current_scheduler() = outer;
+        throw std::length_error(
+            "holden::fiber_scheduler: too many handler locks held at once");
+      }
+      ready_.pop_front();
+      running_ = fiber;
+      state.yield_fiber = &fiber_scheduler::yield_running;
+      state.fiber_scheduler = this;
+      swapcontext(&scheduler_context_, &fiber->context);
+      state.yield_fiber = outer_yield;
+      state.fiber_scheduler = outer_fibers;
+      state.suspend(fiber->dispatch, base_depth, base_held);
+      running_ = nullptr;
+      if (fiber->finished) idle_.push_back(fiber);
+    }
+    current_scheduler() = outer;
+    if (failure_) std::rethrow_exception(std::exchange(failure_, nullptr));
+  }
+
+  static void yield_running(void* self) {
+    static_cast<fiber_scheduler*>(self)->yield();
+  }
+
+  // Called from a fiber: switches back to the scheduler loop. The fiber
+  // only runs again once something puts it back on the ready queue.
+  void suspend() {
+    swapcontext(&running_->context, &scheduler_context_);
+  }
+
+  void wake(detail::fiber* fiber) { ready_.push_back(fiber); }
+
+  detail::fiber* acquire() {
+    detail::fiber* fiber;
+    if (!idle_.empty()) {
+      fiber = idle_.back();
+      idle_.pop_back();
+    } else {
+      fibers_.emplace_back(new detail::fiber());
+      fiber = fibers_.back().get();
+      fiber->stack.reset(new char[stack_size_]);
+    }
+    fiber->finished = false;
+    fiber->dispatch = detail::fiber_dispatch();
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = fiber->stack.get();
+    fiber->context.uc_stack.ss_size = stack_size_;
+    fiber->context.uc_link = nullptr;
+    makecontext(&fiber->context, &fiber_scheduler::entry, 0);
+    return fiber;
+  }
+
+  static void entry() {
+    fiber_scheduler& self = *current_scheduler();
+    detail::fiber* fiber = self.running_;
+    try {
+      fiber->body();
+    } catch (...) {
+      if (!self.failure_) self.failure_ = std::current_exception();
+    }
+    fiber->body.reset();
+    fiber->finished = true;
+    self.suspend();
+  }
+};
+
+// The response to a send made with `fiber_scheduler::send_async`.
+template <typename TResponse>
+class fiber_future {
+  fiber_scheduler* scheduler_;
+  std::shared_ptr<detail::fiber_future_state<TResponse>> state_;
+
+ public:
+  fiber_future(fiber_scheduler& scheduler,
+               std::shared_ptr<detail::fiber_future_state<TResponse>> state)
+    : scheduler_(&scheduler), state_(std::move(state)) {}
+
+  // Move-only, like `std::future`: the state has room for one waiter.
+  fiber_future(fiber_future&&) = default;
+  fiber_future& operator=(fiber_future&&) = default;
+  fiber_future(const fiber_future&) = delete;
+  fiber_future& operator=(const fiber_future&) = delete;
+
+  // False once `get` has been called.
+  bool valid() const { return state_ != nullptr; }
+
+  bool ready() const { return state_ && state_->outcome != nullptr; }
+
+  // Returns the response, or rethrows the handler's exception. From a fiber
+  // this parks the fiber until the handler is done; from outside any fiber
+  // it runs the scheduler until then. Like `std::future::get`, it may be
+  // called once; a second call throws `future_error(no_state)`. If the
+  // scheduler runs out of ready fibers first - the handler waits on
+  // something outside it, or the fibers deadlock - it throws
+  // `future_error(broken_promise)`.
+  TResponse get() {
+    if (!state_) throw std::future_error(std::future_errc::no_state);
+    auto state = std::move(state_);
+    if (!state->outcome) {
+      if (fiber_scheduler::current() == scheduler_
+          && scheduler_->running_ != nullptr) {
+        state->waiter = scheduler_->running_;
+        scheduler_->suspend();
+      } else {
+        scheduler_->run_until([&state] { return state->outcome != nullptr; });
+      }
+    }
+    if (!state->outcome)
+      throw std::future_error(std::future_errc::broken_promise);
+    return std::move(*state->outcome).value();
+  }
+};
+
+template <typename Mediator, typename TRequest>
+auto fiber_scheduler::send_async(Mediator& m, TRequest r)
+-> fiber_future<typename TRequest::response_type> {
+  using response_t = typename TRequest::response_type;
+  auto state = std::make_shared<detail::fiber_future_state<response_t>>();
+  spawn([this, &m, r = std::move(r), state]() {
+    state->outcome.reset(new result<response_t>(
+        detail::capture([&] { return m.send(r); })));
+    if (state->waiter) wake(state->waiter);
+  });
+  return fiber_future<response_t>(*this, std::move(state));
+}
+
+} // namespace holden
+
+#endif // HOLDEN_FIBER_HPP_
@@ -1,70 +1,212 @@
 #ifndef HOLDEN_MEDIATOR_HPP_
 #define HOLDEN_MEDIATOR_HPP_
 
+#include "result.hpp"
+
 #include <cstddef>
+#include <exception>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 
+// Forces inlining even in unoptimised builds, for the thin per-request
+// forwarding functions that would otherwise each be emitted out of line.
+#if defined(__GNUC__)
+#define HOLDEN_MEDIATOR_ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define HOLDEN_MEDIATOR_ALWAYS_INLINE __forceinline
+#else
+#define HOLDEN_MEDIATOR_ALWAYS_INLINE inline
+#endif
+
+// In C++20 a handler need not derive from `request_handler<>`: one with a
+// `handle(const TRequest&)` member is picked up by a concept check instead.
+#if !defined(HOLDEN_MEDIATOR_CONCEPTS)
+#if defined(__cpp_concepts) && __cpp_concepts >= 201907L
+#define HOLDEN_MEDIATOR_CONCEPTS 1
+#else
+#define HOLDEN_MEDIATOR_CONCEPTS 0
+#endif
+#endif
+
 namespace holden {
 
+template <typename TRequest>
+struct request_handler;
+
 namespace detail {
 namespace tuple_searching {
 
-
 template<class...>  struct voider { using type = void; };
 template<class...Ts> using void_t = typename voider<Ts...>::type;
 
-template<template<class...> class Test, class Tuple>
-struct get_first_passing_type;
-template<template<class...> class Test, class Tuple>
-using get_first_passing_type_t
-  = typename get_first_passing_type<Test, Tuple>::type;
-
-template<template<class...> class, class, class...> struct first_passing_type;
-template<template<class...> class Test, class T0, class...Ts>
-struct first_passing_type<Test, std::enable_if_t<!Test<T0>::value>, T0, Ts...>
-  : first_passing_type<Test, void, Ts...>
-{};
-
-template <bool... Ts>
-struct any_of : public std::false_type {  };
-
-template <bool b, bool... Ts>
-struct any_of<b, Ts...>
-  : public std::conditional_t<b, std::true_type, any_of<Ts...>> {};
-
-template<template<class...> class Test, class T0, class...Ts>
-struct first_passing_type<Test, std::enable_if_t<Test<T0>::value>, T0, Ts...> {
-  using type = T0;
-  static_assert(!any_of<Test<Ts>::value...>::value, 
-                "multiple types are registered for a given request");
-};
+// A mediator element may be a wrapper around a handler (see
+// `synchronized<>`), in which case it names the wrapped type as
+// `handler_type` and is matched to requests as if it were that handler.
+template<class T, class = void>
+struct slot_handler { using type = T; };
+template<class T>
+struct slot_handler<T, void_t<typename T::handler_type>>
+  : slot_handler<typename T::handler_type> {};
 
-template<template<class...> class Test,
-  template<class...> class Tuple, class...Ts>
-struct get_first_passing_type<Test, Tuple<Ts...>>
-  : first_passing_type<Test, void, Ts...>
-{};
+template<class T>
+using slot_handler_t = typename slot_handler<std::decay_t<T>>::type;
 
 template<class Base>
 struct is_derived_from {
   template<class Derived>
-  using test = std::is_base_of<std::decay_t<Base>, std::decay_t<Derived>>;
+  using test = std::is_base_of<std::decay_t<Base>, slot_handler_t<Derived>>;
+};
+
+// How many of `Matches` hold, and the position of the first that does,
+// each computed from a single pack expansion: a lookup costs one small
+// instantiation per request type, however many handlers there are.
+template<bool... Matches>
+constexpr std::size_t count_matches() {
+  const bool matches[] = { Matches..., false };
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < sizeof...(Matches); ++i) n += matches[i];
+  return n;
+}
+
+template<bool... Matches>
+constexpr std::size_t first_match() {
+  const bool matches[] = { Matches..., false };
+  std::size_t i = 0;
+  while (i < sizeof...(Matches) && !matches[i]) ++i;
+  return i;
+}
+
+#if HOLDEN_MEDIATOR_CONCEPTS
+
+template<class Handler, class TRequest>
+concept handler_for = requires(Handler& h, const TRequest& r) { h.handle(r); };
+
+// Handlers deriving from `request_handler<TRequest>` win; only when there
+// are none is any handler with a matching `handle` considered. Both checks
+// are compiler builtins (`__is_base_of`, requires-expressions), with no
+// class template instantiated per handler, and the concept checks - which
+// cost an overload resolution per handler - are only made for requests no
+// handler is marked for.
+template<class TRequest, class Tuple>
+struct marked_handlers;
+
+template<class TRequest, class... Ts>
+struct marked_handlers<TRequest, std::tuple<Ts...>> {
+  static constexpr std::size_t count = count_matches<
+    std::is_base_of_v<request_handler<TRequest>, slot_handler_t<Ts>>...>();
+};
+
+template<class TRequest, class Tuple,
+         bool Marked = (marked_handlers<TRequest, Tuple>::count != 0)>
+struct request_matches;
+
+template<class TRequest, class... Ts>
+struct request_matches<TRequest, std::tuple<Ts...>, true> {
+  static constexpr std::size_t marked =
+    marked_handlers<TRequest, std::tuple<Ts...>>::count;
+  static constexpr std::size_t count = marked;
+  static constexpr std::size_t index = first_match<
+    std::is_base_of_v<request_handler<TRequest>, slot_handler_t<Ts>>...>();
 };
 
-template<class Base, class Tuple>
-using get_first_derived =
-  get_first_passing_type_t<is_derived_from<Base>::template test, Tuple>;
+template<class TRequest, class... Ts>
+struct request_matches<TRequest, std::tuple<Ts...>, false> {
+  static constexpr std::size_t marked = 0;
+  static constexpr std::size_t count =
+    count_matches<handler_for<slot_handler_t<Ts>, TRequest>...>();
+  static constexpr std::size_t index =
+    first_match<handler_for<slot_handler_t<Ts>, TRequest>...>();
+};
+
+#else
+
+template<class TRequest, class Tuple>
+struct request_matches;
+
+template<class TRequest, class... Ts>
+struct request_matches<TRequest, std::tuple<Ts...>> {
+  static constexpr std::size_t count = count_matches<
+    is_derived_from<request_handler<TRequest>>::template test<Ts>::value...>();
+  static constexpr std::size_t index = first_match<
+    is_derived_from<request_handler<TRequest>>::template test<Ts>::value...>();
+  static constexpr std::size_t marked = count;
+};
 
-template<class Base, class Tuple>
-auto get_from_base(Tuple&& tuple)
--> decltype(std::get< get_first_derived<Base,
-      std::decay_t<Tuple>> >(std::forward<Tuple>(tuple))) {
-  return std::get< get_first_derived<Base,
-      std::decay_t<Tuple>> >(std::forward<Tuple>(tuple));
+#endif
+
+// How many of the handlers in `Tuple` handle `TRequest`, and where the
+// first is. Unlike `request_index`, asking is never an error.
+template<class TRequest, class Tuple>
+constexpr std::size_t handler_count() {
+  return request_matches<TRequest, Tuple>::count;
 }
 
+template<class TRequest, class Tuple>
+struct request_index {
+  static constexpr std::size_t value =
+    request_matches<TRequest, Tuple>::index;
+
+  static_assert(handler_count<TRequest, Tuple>() > 0,
+                "no handler is registered for a given request");
+  static_assert(handler_count<TRequest, Tuple>() < 2,
+                "multiple types are registered for a given request");
+};
+
+// A request type may name the request it derives from as `base_request`
+// (see request_family.hpp); a request with no handler of its own is then
+// handled as that base, recursively, so the most specific handler wins.
+// Every level must name its own direct base: one inherited from further
+// up makes resolution skip the levels in between.
+//
+// Only handlers deriving from `request_handler<>` count as a level's own:
+// a `handle` taking a base accepts every derived request too, so the
+// concept check cannot tell levels apart. When no level has one, the
+// request is looked up as itself, concept checks included.
+template<class T, class = void>
+struct base_request_of { using type = void; };
+template<class T>
+struct base_request_of<T, void_t<typename T::base_request>> {
+  using type = typename T::base_request;
+  static_assert(std::is_base_of<type, T>::value && !std::is_same<type, T>::value,
+                "a request's base_request must be a base class of it");
+};
+
+template<class TRequest, class Tuple, class Original = TRequest,
+         bool Handled = (request_matches<TRequest, Tuple>::marked != 0),
+         class Base = typename base_request_of<TRequest>::type>
+struct resolve_request { using type = TRequest; };
+template<class TRequest, class Tuple, class Original, class Base>
+struct resolve_request<TRequest, Tuple, Original, false, Base>
+  : resolve_request<Base, Tuple, Original> {};
+template<class TRequest, class Tuple, class Original>
+struct resolve_request<TRequest, Tuple, Original, false, void> {
+  using type = Original;
+};
+
+// The request type `TRequest` is handled as by the handlers in `Tuple`.
+template<class TRequest, class Tuple>
+using resolve_request_t = typename resolve_request<TRequest, Tuple>::type;
+
+// Whether no two of `Ts` handle requests as the same handler type.
+template<class... Ts>
+struct distinct_handlers {
+  template<class T>
+  static constexpr std::size_t occurrences() {
+    return count_matches<
+      std::is_same<slot_handler_t<T>, slot_handler_t<Ts>>::value...>();
+  }
+
+  template<class... Us>
+  static constexpr bool check() {
+    const std::size_t counts[] = { occurrences<Us>()..., 1 };
+    for (std::size_t c : counts) if (c != 1) return false;
+    return true;
+  }
+
+  static constexpr bool value = check<Ts...>();
+};
+
 } // namespace tuple_searching
 
 template<typename T> inline
@@ -94,6 +236,59 @@ template <typename TRequest>
 request_handler<TRequest>::~request_handler() {}
 
 
+namespace detail {
+
+// Completes `receiver` with the outcome of a computation, following the
+// sender/receiver protocol (see execution.hpp).
+template <typename Receiver, typename T>
+void complete(Receiver& receiver, result<T>&& outcome) {
+  if (outcome) receiver.set_value(std::move(outcome).value());
+  else receiver.set_error(outcome.error());
+}
+
+template <typename Receiver>
+void complete(Receiver& receiver, result<void>&& outcome) {
+  if (outcome) receiver.set_value();
+  else receiver.set_error(outcome.error());
+}
+
+template <typename Mediator, typename TRequest, typename Receiver>
+class send_operation {
+  Mediator* mediator_;
+  TRequest request_;
+  Receiver receiver_;
+
+ public:
+  send_operation(Mediator* m, TRequest r, Receiver receiver)
+    : mediator_(m), request_(std::move(r)), receiver_(std::move(receiver)) {}
+
+  void start() noexcept {
+    complete(receiver_, capture([this] { return mediator_->send(request_); }));
+  }
+};
+
+// The sender returned by `mediator::schedule_send`. Sends the request on
+// whichever thread starts it and completes with the response.
+template <typename Mediator, typename TRequest>
+class send_sender {
+  Mediator* mediator_;
+  TRequest request_;
+
+ public:
+  using value_type = typename TRequest::response_type;
+
+  send_sender(Mediator* m, TRequest r) : mediator_(m), request_(std::move(r)) {}
+
+  template <typename Receiver>
+  send_operation<Mediator, TRequest, std::decay_t<Receiver>>
+  connect(Receiver&& receiver) const {
+    return { mediator_, request_, std::forward<Receiver>(receiver) };
+  }
+};
+
+} // namespace detail
+
+
 template <typename ...Handlers>
 class mediator {
  protected:
@@ -102,12 +297,27 @@ class mediator {
  public:
   mediator(Handlers... handlers) : handlers_(handlers...) {}
 
+  // The registered handlers (references, for a mediator made by
+  // `make_mediator`).
+  const std::tuple<Handlers...>& handlers() const { return handlers_; }
+
   template<typename TRequest>
+  HOLDEN_MEDIATOR_ALWAYS_INLINE
   auto send(const TRequest& r) -> typename TRequest::response_type {
-    using namespace detail;
-    using namespace detail::tuple_searching;
-    using handler_t = request_handler<std::decay_t<TRequest>>;
-    return ref(get_from_base<handler_t>(handlers_)).handle(r);
+    using handled_t = detail::tuple_searching::resolve_request_t<
+      std::decay_t<TRequest>, std::tuple<Handlers...>>;
+    constexpr std::size_t index = detail::tuple_searching::request_index<
+      handled_t, std::tuple<Handlers...>>::value;
+    return detail::ref(std::get<index>(handlers_))
+      .handle(static_cast<const handled_t&>(r));
+  }
+
+  // A lazy `send`, as a sender that completes with the response (or the
+  // handler's exception) once started. Compose it with the algorithms in
+  // execution.hpp.
+  template<typename TRequest>
+  detail::send_sender<mediator, TRequest> schedule_send(TRequest r) {
+    return { this, std::move(r) };
   }
 
   virtual ~mediator() {}
@@ -118,6 +328,58 @@ mediator<Args&...> make_mediator(Args&... args) {
   return mediator<Args&...>(args...);
 }
 
+namespace detail {
+
+template <typename T>
+struct is_mediator : std::false_type {};
+template <typename... Handlers>
+struct is_mediator<mediator<Handlers...>> : std::true_type {};
+
+template <typename... Ts>
+struct all_mediators : std::true_type {};
+template <typename T, typename... Ts>
+struct all_mediators<T, Ts...>
+  : std::integral_constant<bool,
+      is_mediator<T>::value && all_mediators<Ts...>::value> {};
+
+template <typename Tuple>
+struct mediator_over;
+template <typename... Handlers>
+struct mediator_over<std::tuple<Handlers...>> {
+  using type = mediator<Handlers...>;
+  static constexpr bool distinct =
+    tuple_searching::distinct_handlers<Handlers...>::value;
+};
+
+template <typename Mediator, typename Tuple, std::size_t... Is>
+Mediator mediator_from(Tuple&& handlers, std::index_sequence<Is...>) {
+  return Mediator(std::get<Is>(std::forward<Tuple>(handlers))...);
+}
+
+} // namespace detail
+
+// One mediator with the handlers of all of `mediators`, in order, as if
+// they had all been passed to `make_mediator` together: sends through it
+// cost no more than through a hand-written one. Handlers a source holds by
+// reference stay references to the same objects; handlers held by value
+// are copied. A handler type registered in more than one source is a
+// compile error, as is a source that is not a plain `mediator`: a
+// `child_mediator` would lose its fallback to its parent.
+template <typename... Mediators>
+auto merge_mediators(const Mediators&... mediators)
+-> typename detail::mediator_over<decltype(
+     std::tuple_cat(mediators.handlers()...))>::type {
+  using handlers_t = decltype(std::tuple_cat(mediators.handlers()...));
+  using merged_t = typename detail::mediator_over<handlers_t>::type;
+  static_assert(detail::all_mediators<Mediators...>::value,
+                "merge_mediators only merges holden::mediator objects");
+  static_assert(detail::mediator_over<handlers_t>::distinct,
+                "a handler type is registered in more than one mediator");
+  return detail::mediator_from<merged_t>(
+      std::tuple_cat(mediators.handlers()...),
+      std::make_index_sequence<std::tuple_size<handlers_t>::value>());
+}
+
 } // namespace holden
 
 #endif // HOLDEN_MEDIATOR_HPP_
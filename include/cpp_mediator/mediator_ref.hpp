@@ -0,0 +1,63 @@
+#ifndef HOLDEN_MEDIATOR_REF_HPP_
+#define HOLDEN_MEDIATOR_REF_HPP_
+
+#include "mediator.hpp"
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+namespace holden {
+
+// A non-owning view of any mediator that can send `Requests...`. Code that
+// only sends requests can take a `mediator_ref<GetA, PutB>` instead of
+// being templated on the full `mediator<HandlerA&, HandlerB&, ...>`, and
+// does not change when handlers are added or moved.
+//
+// The handler list is erased into one static table of function pointers
+// per mediator type, one entry per request; a ref is a pointer to the
+// mediator plus a pointer to that table. Sending costs one indirect call
+// (the mediator's own lookup is inlined into the table entry), with no
+// virtual functions or allocation. The mediator must outlive the ref.
+template <typename... Requests>
+class mediator_ref {
+  template <typename TRequest>
+  using entry_t =
+    typename TRequest::response_type (*)(void*, const TRequest&);
+
+  using table_t = std::tuple<entry_t<Requests>...>;
+
+  template <typename Mediator, typename TRequest>
+  static typename TRequest::response_type
+  entry(void* m, const TRequest& r) {
+    return static_cast<Mediator*>(m)->send(r);
+  }
+
+  template <typename Mediator>
+  static const table_t* table_for() {
+    static constexpr table_t table{ &entry<Mediator, Requests>... };
+    return &table;
+  }
+
+  void* mediator_;
+  const table_t* table_;
+
+ public:
+  template <typename Mediator, typename = std::enable_if_t<
+      !std::is_same<std::decay_t<Mediator>, mediator_ref>::value>>
+  mediator_ref(Mediator& m)
+    : mediator_(&m), table_(table_for<Mediator>()) {}
+
+  template <typename TRequest>
+  auto send(const TRequest& r) -> typename TRequest::response_type {
+    constexpr std::size_t index = detail::tuple_searching::first_match<
+      std::is_same<std::decay_t<TRequest>, Requests>::value...>();
+    static_assert(index < sizeof...(Requests),
+                  "the request is not one this mediator_ref can send");
+    return std::get<index>(*table_)(mediator_, r);
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_MEDIATOR_REF_HPP_
@@ -0,0 +1,92 @@
+#ifndef HOLDEN_POLLED_DISPATCHER_HPP_
+#define HOLDEN_POLLED_DISPATCHER_HPP_
+
+#include "detail/bounded_queue.hpp"
+#include "detail/task.hpp"
+#include "result.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace holden {
+
+// Queues sends in fixed-capacity storage and runs them when `poll()` is
+// called, e.g. from a bare-metal main loop, with no thread, heap or
+// exceptions involved. Everything lives inside the object, so a
+// `polled_dispatcher` may be a static; `Capacity` and `SlotSize` fix its
+// size at compile time.
+//
+// The queue takes no lock, so sends may be queued from an interrupt
+// handler as long as `std::atomic<std::size_t>` is lock-free on the target.
+template <typename Mediator,
+          std::size_t Capacity = 64,
+          std::size_t SlotSize = detail::task::inline_size>
+class polled_dispatcher {
+  using task_t = detail::basic_task<SlotSize>;
+
+  template <typename TRequest, typename Continuation>
+  struct then_job {
+    Mediator* mediator;
+    TRequest request;
+    Continuation continuation;
+
+    void operator()() {
+      continuation(detail::capture(
+          [this] { return mediator->send(request); }));
+    }
+  };
+
+  detail::bounded_queue<task_t, Capacity> queue_;
+  Mediator& mediator_;
+
+ public:
+  explicit polled_dispatcher(Mediator& m) : mediator_(m) {}
+
+  polled_dispatcher(const polled_dispatcher&) = delete;
+  polled_dispatcher& operator=(const polled_dispatcher&) = delete;
+
+  // Queues `r`; the next `poll()` handles it and passes the outcome to
+  // `continuation(result<response_type>)`. Returns false, dropping the
+  // send, if the queue is full.
+  template <typename TRequest, typename Continuation>
+  bool try_send_then(TRequest r, Continuation continuation) {
+    static_assert(sends_inline<TRequest, Continuation>(),
+                  "request and continuation do not fit a queue slot; "
+                  "raise the dispatcher's SlotSize");
+    return queue_.try_push(task_t(then_job<TRequest, Continuation>{
+        &mediator_, std::move(r), std::move(continuation)}));
+  }
+
+  // Whether `try_send_then` with these types fits a queue slot.
+  template <typename TRequest, typename Continuation>
+  static constexpr bool sends_inline() {
+    return task_t::template stores_inline<then_job<TRequest, Continuation>>();
+  }
+
+  // Sends `r` right away, on the calling thread.
+  template <typename TRequest>
+  auto send(const TRequest& r) -> typename TRequest::response_type {
+    return mediator_.send(r);
+  }
+
+  // Runs up to `max_sends` queued sends, oldest first, including any they
+  // queue in turn. Returns how many ran.
+  std::size_t poll(std::size_t max_sends = Capacity) {
+    std::size_t ran = 0;
+    task_t t;
+    while (ran < max_sends && queue_.try_pop(t)) {
+      t();
+      t.reset();
+      ++ran;
+    }
+    return ran;
+  }
+
+  bool empty() const { return queue_.empty(); }
+
+  Mediator& mediator() { return mediator_; }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_POLLED_DISPATCHER_HPP_
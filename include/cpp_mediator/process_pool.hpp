@@ -0,0 +1,97 @@
+#ifndef HOLDEN_PROCESS_POOL_HPP_
+#define HOLDEN_PROCESS_POOL_HPP_
+
+#include "process_proxy.hpp"
+#include "remote_handler_error.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace holden {
+
+// Spreads requests for a CPU-heavy, non-thread-safe handler over several
+// forked worker processes, each hosting its own copy of `Handler` behind a
+// `process_proxy`. Each request goes to the live worker with the fewest
+// requests outstanding; ties are broken round-robin.
+//
+// Workers found dead are skipped from then on; if none are left, requests
+// fail with `remote_handler_error`.
+template <typename Handler, typename... Requests>
+class process_pool : public request_handler<Requests>... {
+  using proxy_t = process_proxy<Handler, Requests...>;
+
+  struct worker {
+    std::unique_ptr<proxy_t> proxy;
+    std::atomic<std::uint32_t> outstanding{0};
+    char pad[detail::cache_line_size];
+  };
+
+  std::size_t size_;
+  std::unique_ptr<worker[]> workers_;
+  std::atomic<std::size_t> next_{0};
+
+ public:
+  explicit process_pool(
+      Handler& handler,
+      std::size_t workers = std::max(1u, std::thread::hardware_concurrency()))
+    : size_(workers), workers_(new worker[workers]) {
+    for (std::size_t i = 0; i < size_; ++i)
+      workers_[i].proxy.reset(new proxy_t(handler));
+  }
+
+  process_pool(const process_pool&) = delete;
+  process_pool& operator=(const process_pool&) = delete;
+
+  std::size_t size() const { return size_; }
+
+  const proxy_t& worker_at(std::size_t i) const { return *workers_[i].proxy; }
+
+  std::uint32_t outstanding(std::size_t i) const {
+    return workers_[i].outstanding.load(std::memory_order_relaxed);
+  }
+
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    worker& w = pick();
+    struct release {
+      worker& w;
+      ~release() { w.outstanding.fetch_sub(1, std::memory_order_relaxed); }
+    } guard{w};
+    return w.proxy->handle(r);
+  }
+
+ private:
+  // Claims the least loaded live worker. The claim is a compare-and-swap on
+  // the count that was read, so racing callers never both take a worker
+  // that only had room for one of them at the minimum.
+  worker& pick() {
+    for (;;) {
+      const std::size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+      worker* best = nullptr;
+      std::uint32_t fewest = 0;
+      for (std::size_t k = 0; k < size_; ++k) {
+        worker& w = workers_[(start + k) % size_];
+        if (w.proxy->exited()) continue;
+        const auto n = w.outstanding.load(std::memory_order_relaxed);
+        if (!best || n < fewest) {
+          best = &w;
+          fewest = n;
+          if (n == 0) break;
+        }
+      }
+      if (!best)
+        throw remote_handler_error("all request handler processes exited");
+      if (best->outstanding.compare_exchange_strong(
+              fewest, fewest + 1, std::memory_order_relaxed))
+        return *best;
+    }
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_PROCESS_POOL_HPP_
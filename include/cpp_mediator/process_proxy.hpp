@@ -0,0 +1,261 @@
+#ifndef HOLDEN_PROCESS_PROXY_HPP_
+#define HOLDEN_PROCESS_PROXY_HPP_
+
+#include "detail/bounded_queue.hpp"
+#include "detail/cpu.hpp"
+#include "detail/futex.hpp"
+#include "detail/wire.hpp"
+#include "mediator.hpp"
+#include "remote_handler_error.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace holden {
+
+// Hosts a copy of `Handler` in a forked child process, so a crash in the
+// handler cannot take the caller down. The proxy is itself a handler for
+// `Requests...` and is registered with a mediator in place of the original:
+//
+//   process_proxy<Legacy, Parse, Render> isolated(legacy);
+//   auto m = make_mediator(isolated, other_handler);
+//
+// Requests and responses travel through a region of shared memory: callers
+// claim a slot, memcpy the request into it and push the slot's index onto a
+// lock-free submission ring; the child handles it in place and flips the
+// slot's state word. Both sides spin briefly and then sleep on futexes, so a
+// round trip costs no socket or pipe syscalls and at most two futex wakes.
+//
+// All request and response types must be trivially copyable. The child is
+// created with fork(), so construct proxies before starting other threads.
+template <typename Handler, typename... Requests>
+class process_proxy : public request_handler<Requests>... {
+  static_assert(
+      detail::all_of<detail::check_wire_safe<Requests>::value...>::value, "");
+
+  static constexpr std::size_t slot_count = 64;
+  static constexpr std::size_t payload_size =
+      detail::max_payload_size<Requests...>::value > 0
+        ? detail::max_payload_size<Requests...>::value : 1;
+  static constexpr unsigned spin_limit = 1024;
+  static constexpr std::chrono::milliseconds liveness_interval{20};
+
+  enum : std::uint32_t {
+    slot_free,
+    slot_pending,
+    slot_pending_sleeper,  // pending, and the caller sleeps on the futex
+    slot_done,
+    slot_failed,
+  };
+
+  struct slot {
+    std::atomic<std::uint32_t> state;
+    std::uint32_t request_index;
+    // Holds the request, then is overwritten with the response.
+    alignas(std::max_align_t) unsigned char payload[payload_size];
+  };
+
+  struct channel {
+    detail::bounded_queue<std::uint32_t, slot_count> free_slots;
+    detail::bounded_queue<std::uint32_t, slot_count> submitted;
+    detail::event_count child_wakeup{true};
+    std::atomic<bool> stopping{false};
+    slot slots[slot_count];
+  };
+
+  channel* channel_;
+  pid_t pid_;
+  std::atomic<bool> exited_{false};
+
+ public:
+  explicit process_proxy(Handler& handler) {
+    void* memory = ::mmap(nullptr, sizeof(channel), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    channel_ = ::new (memory) channel();
+    for (std::uint32_t i = 0; i < slot_count; ++i) {
+      channel_->slots[i].state.store(slot_free, std::memory_order_relaxed);
+      channel_->free_slots.try_push(i);
+    }
+
+    const pid_t parent = ::getpid();
+    pid_ = ::fork();
+    if (pid_ < 0) {
+      const int error = errno;
+      release_channel();
+      throw std::system_error(error, std::generic_category(), "fork");
+    }
+    if (pid_ == 0) {
+      serve(*channel_, handler, parent);
+      ::_exit(0);
+    }
+  }
+
+  process_proxy(const process_proxy&) = delete;
+  process_proxy& operator=(const process_proxy&) = delete;
+
+  // Lets the child finish in-flight requests, then reaps it.
+  ~process_proxy() {
+    channel_->stopping.store(true, std::memory_order_release);
+    channel_->child_wakeup.notify_one();
+    if (!exited_.exchange(true)) {
+      int status;
+      while (::waitpid(pid_, &status, 0) < 0 && errno == EINTR) {}
+    }
+    release_channel();
+  }
+
+  pid_t pid() const { return pid_; }
+
+  // True once a request found the child dead. Never makes a syscall.
+  bool exited() const { return exited_.load(std::memory_order_acquire); }
+
+  // Forwards `r` to the child and waits for its response. Thread-safe; up to
+  // 64 requests may be in flight at once.
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    using response_t = typename TRequest::response_type;
+
+    const std::uint32_t index = acquire_slot();
+    slot& s = channel_->slots[index];
+    std::memcpy(s.payload, &r, sizeof(TRequest));
+    s.request_index = static_cast<std::uint32_t>(
+        detail::index_of<TRequest, Requests...>::value);
+    s.state.store(slot_pending, std::memory_order_relaxed);
+    while (!channel_->submitted.try_push(index)) detail::cpu_relax();
+    channel_->child_wakeup.notify_one();
+
+    if (await(s) == slot_failed) {
+      release_slot(index);
+      throw remote_handler_error("request handler threw in hosting process");
+    }
+    return take_response<response_t>(index);
+  }
+
+ private:
+  template <typename TResponse>
+  std::enable_if_t<!std::is_void<TResponse>::value, TResponse>
+  take_response(std::uint32_t index) {
+    auto response = detail::load<TResponse>(channel_->slots[index].payload);
+    release_slot(index);
+    return response;
+  }
+
+  template <typename TResponse>
+  std::enable_if_t<std::is_void<TResponse>::value>
+  take_response(std::uint32_t index) {
+    release_slot(index);
+  }
+
+  std::uint32_t acquire_slot() {
+    std::uint32_t index;
+    for (unsigned attempt = 0; !channel_->free_slots.try_pop(index);
+         ++attempt) {
+      if (attempt < spin_limit) {
+        detail::cpu_relax();
+      } else {
+        if (!child_alive())
+          throw remote_handler_error("request handler process exited");
+        std::this_thread::yield();
+      }
+    }
+    return index;
+  }
+
+  void release_slot(std::uint32_t index) {
+    channel_->slots[index].state.store(slot_free, std::memory_order_relaxed);
+    channel_->free_slots.try_push(index);
+  }
+
+  // Waits until the child has answered the request in `s`.
+  std::uint32_t await(slot& s) {
+    std::uint32_t state;
+    for (unsigned i = 0; i < spin_limit; ++i) {
+      state = s.state.load(std::memory_order_acquire);
+      if (state >= slot_done) return state;
+      detail::cpu_relax();
+    }
+    for (;;) {
+      std::uint32_t expected = slot_pending;
+      s.state.compare_exchange_strong(expected, slot_pending_sleeper,
+                                      std::memory_order_acq_rel);
+      state = s.state.load(std::memory_order_acquire);
+      if (state >= slot_done) return state;
+      detail::futex_wait_for(s.state, slot_pending_sleeper, liveness_interval,
+                             true);
+      state = s.state.load(std::memory_order_acquire);
+      if (state >= slot_done) return state;
+      // The slot is abandoned rather than recycled: a child that died
+      // mid-request may have left it half written.
+      if (!child_alive())
+        throw remote_handler_error("request handler process exited");
+    }
+  }
+
+  bool child_alive() {
+    if (exited_.load(std::memory_order_acquire)) return false;
+    int status;
+    if (::waitpid(pid_, &status, WNOHANG) == 0) return true;
+    exited_.store(true, std::memory_order_release);
+    return false;
+  }
+
+  void release_channel() {
+    channel_->~channel();
+    ::munmap(channel_, sizeof(channel));
+  }
+
+  static void serve(channel& ch, Handler& handler, pid_t parent) {
+    static const detail::encoded_handler_fn<Handler> handlers[] = {
+      &detail::handle_encoded<Requests, Handler>...
+    };
+
+    std::uint32_t index;
+    for (;;) {
+      if (ch.submitted.try_pop(index)) {
+        slot& s = ch.slots[index];
+        std::uint32_t outcome = slot_done;
+        try {
+          handlers[s.request_index](handler, s.payload, s.payload);
+        } catch (...) {
+          outcome = slot_failed;
+        }
+        if (s.state.exchange(outcome, std::memory_order_acq_rel)
+            == slot_pending_sleeper)
+          detail::futex_wake(s.state, 1, true);
+        continue;
+      }
+      if (ch.stopping.load(std::memory_order_acquire)) return;
+      // Orphaned children exit on their own.
+      if (::getppid() != parent) return;
+
+      const auto key = ch.child_wakeup.prepare_wait();
+      if (!ch.submitted.empty() || ch.stopping.load())
+        ch.child_wakeup.cancel_wait();
+      else
+        ch.child_wakeup.wait_for(key, std::chrono::milliseconds(100));
+    }
+  }
+};
+
+template <typename Handler, typename... Requests>
+constexpr std::chrono::milliseconds
+process_proxy<Handler, Requests...>::liveness_interval;
+
+} // namespace holden
+
+#endif // HOLDEN_PROCESS_PROXY_HPP_
@@ -0,0 +1,56 @@
+#ifndef HOLDEN_REALTIME_HPP_
+#define HOLDEN_REALTIME_HPP_
+
+#include "dispatcher.hpp"
+
+#include <cstddef>
+#include <utility>
+
+namespace holden {
+
+// A dispatcher restricted to the sends that are safe from a real-time
+// thread (an audio callback, a control loop): every send is stored in a
+// slot of the pre-allocated queue, never on the heap; a full queue is
+// reported rather than waited on; and the worker busy-polls, so a send
+// never has to wake it with a syscall. Nothing on the sending path, nor on
+// the worker between tasks, allocates, locks or enters the kernel.
+//
+// Handlers and continuations run on the worker and must keep to the same
+// rules for the worker to stay real-time safe; in particular, do not
+// register `synchronized<>` handlers with the mediator. The worker spins on
+// its core for the dispatcher's whole life, so pin it (`cpu`) to a core set
+// aside for it.
+template <typename Mediator,
+          std::size_t Capacity = 1024,
+          std::size_t SlotSize = detail::task::inline_size>
+class realtime_dispatcher {
+  using dispatcher_t = dispatcher<Mediator, busy_poll_wait, Capacity, SlotSize>;
+  dispatcher_t dispatcher_;
+
+ public:
+  static constexpr int any_cpu = -1;
+
+  // Starting the worker allocates; do it before entering the real-time
+  // section.
+  explicit realtime_dispatcher(Mediator& m, int cpu = any_cpu)
+    : dispatcher_(m, busy_poll_wait(), cpu) {}
+
+  // Queues `r` and has `continuation(result<response_type>)` called on the
+  // worker once it is handled. Returns false, dropping the send, when the
+  // queue is full. Sends that do not fit a slot fail to compile.
+  template <typename TRequest, typename Continuation>
+  bool try_send_then(TRequest r, Continuation continuation) {
+    return dispatcher_.try_send_then(std::move(r), std::move(continuation));
+  }
+
+  template <typename TRequest, typename Continuation>
+  static constexpr bool sends_inline() {
+    return dispatcher_t::template sends_inline<TRequest, Continuation>();
+  }
+
+  bool on_worker() const { return dispatcher_.on_worker(); }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_REALTIME_HPP_
@@ -0,0 +1,17 @@
+#ifndef HOLDEN_REMOTE_HANDLER_ERROR_HPP_
+#define HOLDEN_REMOTE_HANDLER_ERROR_HPP_
+
+#include <stdexcept>
+
+namespace holden {
+
+// Thrown when a request handled in another process fails: the handler threw,
+// its process died, or the connection to it was lost.
+class remote_handler_error : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+} // namespace holden
+
+#endif // HOLDEN_REMOTE_HANDLER_ERROR_HPP_
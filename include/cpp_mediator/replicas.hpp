@@ -0,0 +1,168 @@
+#ifndef HOLDEN_REPLICAS_HPP_
+#define HOLDEN_REPLICAS_HPP_
+
+#include "detail/per_thread.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace holden {
+
+// Selection policies for `replicas`: each provides a `selector<N>` whose
+// `acquire()` picks the replica for a send and whose `release(i)` is called
+// once that send returns.
+
+// Spreads sends evenly, in turn.
+struct round_robin {
+  template <std::size_t N>
+  class selector {
+    std::atomic<std::size_t> next_{0};
+
+   public:
+    std::size_t acquire() {
+      return next_.fetch_add(1, std::memory_order_relaxed) % N;
+    }
+    void release(std::size_t) {}
+  };
+};
+
+// Sends from one thread always go to the same replica. Each thread takes
+// the lowest slot not held by another running thread on its first send
+// and gives it back when it exits; with no more running threads than
+// replicas, each thread has a replica to itself.
+struct thread_affinity {
+  template <std::size_t N>
+  class selector {
+    std::mutex mutex_;
+    std::vector<bool> taken_;
+    detail::per_thread<std::size_t> slots_ =
+      detail::per_thread<std::size_t>::make<
+        selector, &selector::thread_exited>(this);
+
+    static void thread_exited(selector* self, std::size_t slot) {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      self->taken_[slot] = false;
+    }
+
+   public:
+    std::size_t acquire() {
+      std::size_t slot;
+      if (!slots_.find(slot)) {
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          slot = 0;
+          while (slot < taken_.size() && taken_[slot]) ++slot;
+          if (slot == taken_.size()) taken_.push_back(true);
+          else taken_[slot] = true;
+        }
+        slots_.bind(slot);
+      }
+      return slot % N;
+    }
+    void release(std::size_t) {}
+  };
+};
+
+// Picks the replica with the fewest sends in progress, so a replica stuck
+// on a slow request is passed over.
+struct least_loaded {
+  template <std::size_t N>
+  class selector {
+    std::array<std::atomic<std::size_t>, N> in_flight_{};
+
+   public:
+    std::size_t acquire() {
+      std::size_t best = 0;
+      std::size_t best_load = in_flight_[0].load(std::memory_order_relaxed);
+      for (std::size_t i = 1; i < N && best_load != 0; ++i) {
+        const std::size_t load = in_flight_[i].load(std::memory_order_relaxed);
+        if (load < best_load) {
+          best = i;
+          best_load = load;
+        }
+      }
+      in_flight_[best].fetch_add(1, std::memory_order_relaxed);
+      return best;
+    }
+    void release(std::size_t i) {
+      in_flight_[i].fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::size_t in_flight(std::size_t i) const {
+      return in_flight_[i].load(std::memory_order_relaxed);
+    }
+  };
+};
+
+// N instances of one handler, registered with a mediator as a single
+// handler of that type, with `Selector` choosing the instance each send
+// goes to:
+//
+//   replicas<Shard, 8, thread_affinity> shards;
+//   auto m = make_mediator(shards, other_handler);
+//
+// The replicas take no lock. Under `thread_affinity` with no more sending
+// threads than replicas, no replica is entered concurrently; under the
+// other policies one can be, so `Handler` must tolerate that (state
+// partitioned per replica still cuts contention N-fold).
+template <typename Handler, std::size_t N,
+          typename Selector = round_robin>
+class replicas {
+  static_assert(N > 0, "replicas needs at least one instance");
+
+  std::array<Handler, N> replicas_;
+  typename Selector::template selector<N> selector_;
+
+  struct release_guard {
+    typename Selector::template selector<N>& selector;
+    std::size_t index;
+    ~release_guard() { selector.release(index); }
+  };
+
+ public:
+  using handler_type = Handler;
+  static constexpr std::size_t size = N;
+
+  replicas() = default;
+
+  // Constructs every replica from the same arguments.
+  template <typename... Args>
+  explicit replicas(const Args&... args)
+    : replicas(std::make_index_sequence<N>(), args...) {}
+
+  replicas(const replicas&) = delete;
+  replicas& operator=(const replicas&) = delete;
+
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    release_guard guard{selector_, selector_.acquire()};
+    return replicas_[guard.index].handle(r);
+  }
+
+  Handler& operator[](std::size_t i) { return replicas_[i]; }
+  const Handler& operator[](std::size_t i) const { return replicas_[i]; }
+
+  // Calls `f(replica)` on each replica in turn, e.g. to merge their state.
+  // Not synchronised with sends in progress.
+  template <typename F>
+  void for_each(F&& f) {
+    for (auto& replica : replicas_) f(replica);
+  }
+
+  const typename Selector::template selector<N>& selector() const {
+    return selector_;
+  }
+
+ private:
+  template <std::size_t... Is, typename... Args>
+  replicas(std::index_sequence<Is...>, const Args&... args)
+    : replicas_{{ (static_cast<void>(Is), Handler(args...))... }} {}
+};
+
+} // namespace holden
+
+#endif // HOLDEN_REPLICAS_HPP_
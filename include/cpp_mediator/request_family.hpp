@@ -0,0 +1,143 @@
+#ifndef HOLDEN_REQUEST_FAMILY_HPP_
+#define HOLDEN_REQUEST_FAMILY_HPP_
+
+#include "mediator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace holden {
+
+// A closed family of request types sharing a root, root first:
+//
+//   struct OrderEvent;
+//   struct OrderPlaced;
+//   struct OrderCancelled;
+//   using order_events =
+//     request_family<OrderEvent, OrderPlaced, OrderCancelled>;
+//
+//   struct OrderEvent : family_root<order_events, void> {};
+//   struct OrderPlaced : derived_request<OrderPlaced, OrderEvent> { ... };
+//   struct OrderCancelled : derived_request<OrderCancelled, OrderEvent> {};
+//
+// `mediator::send` resolves a family member to the most specific handler
+// from its static type, at compile time. `send_dynamic` does the same for
+// a request known only through a reference to one of its bases, by its
+// dynamic type: each member records its position in the family, which
+// indexes a table of per-member sends.
+template <typename Root, typename... Members>
+struct request_family {
+  using root = Root;
+  static constexpr std::size_t size = 1 + sizeof...(Members);
+
+  template <typename T>
+  static constexpr std::size_t index_of() {
+    return detail::tuple_searching::first_match<
+      std::is_same<T, Root>::value, std::is_same<T, Members>::value...>();
+  }
+};
+
+// The root of a request family. Members derive from it through
+// `derived_request`.
+//
+// Copies never take the family index of their source: copying a member
+// into one of its bases slices it, and the copy is then of the base's
+// type. Each level re-stamps its own index as it is constructed.
+template <typename Family, typename TResponse>
+class family_root : public request<TResponse> {
+  std::uint32_t family_index_ = 0;
+
+ protected:
+  void set_family_index(std::size_t i) {
+    family_index_ = static_cast<std::uint32_t>(i);
+  }
+
+ public:
+  using family = Family;
+
+  family_root() = default;
+  family_root(const family_root& other) : request<TResponse>(other) {}
+  family_root& operator=(const family_root& other) {
+    request<TResponse>::operator=(other);
+    return *this;
+  }
+
+  // The position of the request's dynamic type in `Family`.
+  std::size_t family_index() const { return family_index_; }
+};
+
+// Derives request `Derived` from `Base`, another member of the same family:
+// names `Base` as `Derived`'s `base_request` and tags objects with
+// `Derived`'s family index. Constructor arguments are passed on to `Base`.
+template <typename Derived, typename Base>
+struct derived_request : Base {
+  using base_request = Base;
+
+  template <typename... Args>
+  explicit derived_request(Args&&... args) : Base(std::forward<Args>(args)...) {
+    stamp();
+  }
+
+  derived_request(const derived_request& other)
+    : Base(static_cast<const Base&>(other)) {
+    stamp();
+  }
+  derived_request(derived_request&& other)
+    : Base(static_cast<Base&&>(other)) {
+    stamp();
+  }
+  derived_request& operator=(const derived_request&) = default;
+  derived_request& operator=(derived_request&&) = default;
+
+ private:
+  void stamp() {
+    constexpr std::size_t index =
+      Base::family::template index_of<Derived>();
+    static_assert(index < Base::family::size,
+                  "request is not listed in its request family");
+    this->set_family_index(index);
+  }
+};
+
+namespace detail {
+
+template <typename Mediator, typename Root, typename Member>
+typename Root::response_type send_member(Mediator& m, const Root& r) {
+  return m.send(static_cast<const Member&>(r));
+}
+
+template <typename Mediator, typename Family>
+struct family_dispatch;
+
+template <typename Mediator, typename Root, typename... Members>
+struct family_dispatch<Mediator, request_family<Root, Members...>> {
+  using entry_t = typename Root::response_type (*)(Mediator&, const Root&);
+
+  static const entry_t* table() {
+    static constexpr entry_t entries[] = {
+      &send_member<Mediator, Root, Root>,
+      &send_member<Mediator, Root, Members>...
+    };
+    return entries;
+  }
+};
+
+} // namespace detail
+
+// Sends `r` as its dynamic type: one indexed indirect call, with no
+// `dynamic_cast` or type comparisons. Each member of the family goes to
+// its most specific handler, so every member must have one.
+template <typename Mediator, typename TRequest>
+auto send_dynamic(Mediator& m, const TRequest& r)
+-> typename TRequest::response_type {
+  using family_t = typename TRequest::family;
+  const typename family_t::root& root = r;
+  return detail::family_dispatch<Mediator, family_t>::table()
+    [root.family_index()](m, root);
+}
+
+} // namespace holden
+
+#endif // HOLDEN_REQUEST_FAMILY_HPP_
@@ -0,0 +1,112 @@
+#ifndef HOLDEN_RESULT_HPP_
+#define HOLDEN_RESULT_HPP_
+
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Without exception support (-fno-exceptions) a handler cannot throw, so
+// every result holds a value and nothing is caught.
+#if !defined(HOLDEN_MEDIATOR_EXCEPTIONS)
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS)
+#define HOLDEN_MEDIATOR_EXCEPTIONS 1
+#else
+#define HOLDEN_MEDIATOR_EXCEPTIONS 0
+#endif
+#endif
+
+namespace holden {
+
+// The outcome of handling a request off the caller's stack: either the
+// handler's response or the exception it threw. Unlike a future it is a
+// plain value with no shared state, so it can be handed to a callback.
+template <typename T>
+class result {
+  union { T value_; };
+  std::exception_ptr error_;
+  bool has_value_;
+
+ public:
+  result(T value) : value_(std::move(value)), has_value_(true) {}
+  result(std::exception_ptr error)
+    : error_(std::move(error)), has_value_(false) {}
+
+  result(result&& other) noexcept(std::is_nothrow_move_constructible<T>::value)
+    : error_(std::move(other.error_)), has_value_(other.has_value_) {
+    if (has_value_) ::new (&value_) T(std::move(other.value_));
+  }
+
+  result& operator=(result&& other) = delete;
+
+  ~result() {
+    if (has_value_) value_.~T();
+  }
+
+  bool has_value() const { return has_value_; }
+  explicit operator bool() const { return has_value_; }
+
+  const std::exception_ptr& error() const { return error_; }
+
+  // The response, or rethrows the handler's exception.
+  T& value() & {
+    if (!has_value_) std::rethrow_exception(error_);
+    return value_;
+  }
+  T&& value() && { return std::move(value()); }
+};
+
+template <>
+class result<void> {
+  std::exception_ptr error_;
+
+ public:
+  result() = default;
+  result(std::exception_ptr error) : error_(std::move(error)) {}
+
+  bool has_value() const { return !error_; }
+  explicit operator bool() const { return has_value(); }
+
+  const std::exception_ptr& error() const { return error_; }
+
+  void value() const {
+    if (error_) std::rethrow_exception(error_);
+  }
+};
+
+namespace detail {
+
+// Runs `f`, capturing its return value or exception.
+template <typename F, typename R = decltype(std::declval<F&>()())>
+auto capture(F&& f) -> std::enable_if_t<!std::is_void<R>::value, result<R>> {
+#if HOLDEN_MEDIATOR_EXCEPTIONS
+  try {
+    return result<R>(f());
+  } catch (...) {
+    return result<R>(std::current_exception());
+  }
+#else
+  return result<R>(f());
+#endif
+}
+
+template <typename F, typename R = decltype(std::declval<F&>()())>
+auto capture(F&& f) -> std::enable_if_t<std::is_void<R>::value, result<R>> {
+#if HOLDEN_MEDIATOR_EXCEPTIONS
+  try {
+    f();
+    return result<R>();
+  } catch (...) {
+    return result<R>(std::current_exception());
+  }
+#else
+  f();
+  return result<R>();
+#endif
+}
+
+} // namespace detail
+
+} // namespace holden
+
+#endif // HOLDEN_RESULT_HPP_
@@ -0,0 +1,262 @@
+#ifndef HOLDEN_SIMULATION_HPP_
+#define HOLDEN_SIMULATION_HPP_
+
+#include "detail/dispatch_state.hpp"
+#include "detail/task.hpp"
+#include "result.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace holden {
+
+// Counters a simulation keeps while it runs, all in virtual time.
+struct simulation_stats {
+  std::uint64_t tasks_run = 0;
+  std::uint64_t timers_fired = 0;
+  // The longest the ready queue got: how far work piled up.
+  std::size_t max_ready = 0;
+  // How long tasks sat ready before running, summed and at worst.
+  std::chrono::nanoseconds total_queue_delay{0};
+  std::chrono::nanoseconds max_queue_delay{0};
+};
+
+// Runs a mediator's async sends, continuations and timers on the calling
+// thread against a virtual clock, so a concurrent workload replays exactly.
+// It offers the same sending interface as `dispatcher` (`send_then`,
+// `send_async`, `execute`, ...), so code written against one runs on the
+// other.
+//
+// Nothing runs until `run()`, `run_until()` or `step()` is called. Each
+// step picks one ready task: the oldest one, or - when constructed with a
+// seed - one chosen by a seeded PRNG, which explores other interleavings
+// while staying reproducible. When nothing is ready, the clock jumps to the
+// next timer. Time otherwise only moves when a handler calls `advance()` to
+// model its own cost, so queueing delays in `stats()` are in those terms.
+//
+// Sends made while a task runs are queued rather than run inline, since
+// exposing that queueing is the point; use `send` for an inline send. A
+// `send_async` future is only ready once the simulation has run the send,
+// so do not wait on it from inside the simulation.
+template <typename Mediator>
+class simulation {
+ public:
+  using duration = std::chrono::nanoseconds;
+  using time_point = duration;  // since the simulation started
+
+ private:
+  struct ready_task {
+    std::uint64_t id;
+    time_point queued_at;
+    detail::task task;
+  };
+
+  struct timer {
+    time_point due;
+    std::uint64_t id;
+    detail::task task;
+  };
+
+  // Orders the timer heap earliest first, ties by scheduling order.
+  struct fires_later {
+    bool operator()(const timer& a, const timer& b) const {
+      return a.due != b.due ? a.due > b.due : a.id > b.id;
+    }
+  };
+
+  template <typename TRequest, typename Continuation>
+  struct then_job {
+    simulation* self;
+    TRequest request;
+    Continuation continuation;
+
+    void operator()() {
+      continuation(detail::capture(
+          [this] { return self->mediator_.send(request); }));
+    }
+  };
+
+  Mediator& mediator_;
+  bool shuffled_;
+  std::mt19937_64 rng_;
+  time_point now_{0};
+  std::uint64_t next_id_ = 0;
+  std::deque<ready_task> ready_;
+  std::vector<timer> timers_;
+  simulation_stats stats_;
+  bool tracing_ = false;
+  std::vector<std::uint64_t> trace_;
+  bool running_ = false;
+
+ public:
+  // Runs ready tasks oldest first.
+  explicit simulation(Mediator& m) : mediator_(m), shuffled_(false) {}
+
+  // Runs ready tasks in an order drawn from `seed`; the same seed and the
+  // same workload give the same interleaving.
+  simulation(Mediator& m, std::uint64_t seed)
+    : mediator_(m), shuffled_(true), rng_(seed) {}
+
+  simulation(const simulation&) = delete;
+  simulation& operator=(const simulation&) = delete;
+
+  template <typename TRequest, typename Continuation>
+  void send_then(TRequest r, Continuation continuation) {
+    execute(then_job<TRequest, Continuation>{this, std::move(r),
+                                             std::move(continuation)});
+  }
+
+  template <typename TRequest>
+  auto send_async(TRequest r)
+  -> std::future<typename TRequest::response_type> {
+    std::promise<typename TRequest::response_type> p;
+    auto f = p.get_future();
+    execute([this, r = std::move(r), p = std::move(p)]() mutable {
+      auto outcome = detail::capture([&] { return mediator_.send(r); });
+      fulfil(p, std::move(outcome));
+    });
+    return f;
+  }
+
+  // Sends `r` right away, on the calling thread.
+  template <typename TRequest>
+  auto send(const TRequest& r) -> typename TRequest::response_type {
+    detail::dispatch_frame frame(detail::this_thread_dispatch());
+    return mediator_.send(r);
+  }
+
+  template <typename F>
+  void execute(F f) {
+    ready_.push_back({ next_id_++, now_, detail::task(std::move(f)) });
+    stats_.max_ready = std::max(stats_.max_ready, ready_.size());
+  }
+
+  // Makes `f` ready once the clock reaches `due`.
+  template <typename F>
+  void call_at(time_point due, F f) {
+    timers_.push_back({ std::max(due, now_), next_id_++,
+                        detail::task(std::move(f)) });
+    std::push_heap(timers_.begin(), timers_.end(), fires_later());
+  }
+
+  template <typename F>
+  void call_after(duration delay, F f) { call_at(now_ + delay, std::move(f)); }
+
+  // `send_then`, issued once `delay` has passed.
+  template <typename TRequest, typename Continuation>
+  void send_after(duration delay, TRequest r, Continuation continuation) {
+    call_after(delay, then_job<TRequest, Continuation>{this, std::move(r),
+                                                       std::move(continuation)});
+  }
+
+  Mediator& mediator() { return mediator_; }
+
+  // True while the simulation is running a task.
+  bool on_worker() const { return running_; }
+
+  time_point now() const { return now_; }
+
+  // Moves the clock forward, e.g. from a handler modelling its own cost.
+  void advance(duration d) { now_ += d; }
+
+  // Runs one task, firing due timers first and jumping the clock to the
+  // next timer if nothing is ready. False once there is nothing left.
+  bool step() {
+    if (ready_.empty() && !timers_.empty() && timers_.front().due > now_)
+      now_ = timers_.front().due;
+    fire_due_timers();
+    if (ready_.empty()) return false;
+
+    std::size_t pick = shuffled_ ? static_cast<std::size_t>(rng_() % ready_.size())
+                                 : 0;
+    ready_task next = take(pick);
+    const duration waited = now_ - next.queued_at;
+    stats_.total_queue_delay += waited;
+    stats_.max_queue_delay = std::max(stats_.max_queue_delay, waited);
+    ++stats_.tasks_run;
+    if (tracing_) trace_.push_back(next.id);
+
+    running_ = true;
+    struct reset_running {
+      bool& flag;
+      ~reset_running() { flag = false; }
+    } reset{running_};
+    detail::dispatch_frame frame(detail::this_thread_dispatch());
+    next.task();
+    return true;
+  }
+
+  // Runs until there are no tasks or timers left.
+  void run() {
+    while (step()) {}
+  }
+
+  // Runs everything that becomes ready up to `deadline`, then leaves the
+  // clock there.
+  void run_until(time_point deadline) {
+    for (;;) {
+      if (ready_.empty()
+          && (timers_.empty() || timers_.front().due > deadline)) break;
+      step();
+    }
+    now_ = std::max(now_, deadline);
+  }
+
+  void run_for(duration d) { run_until(now_ + d); }
+
+  // Tasks and timers not run yet.
+  std::size_t pending() const { return ready_.size() + timers_.size(); }
+
+  const simulation_stats& stats() const { return stats_; }
+
+  // With tracing on, every task run is recorded by the order it was
+  // scheduled in, so two runs can be compared step by step.
+  void set_tracing(bool on) { tracing_ = on; }
+  const std::vector<std::uint64_t>& trace() const { return trace_; }
+
+ private:
+  template <typename T>
+  static void fulfil(std::promise<T>& p, result<T>&& outcome) {
+    if (outcome) p.set_value(std::move(outcome).value());
+    else p.set_exception(outcome.error());
+  }
+
+  static void fulfil(std::promise<void>& p, result<void>&& outcome) {
+    if (outcome) p.set_value();
+    else p.set_exception(outcome.error());
+  }
+
+  void fire_due_timers() {
+    while (!timers_.empty() && timers_.front().due <= now_) {
+      std::pop_heap(timers_.begin(), timers_.end(), fires_later());
+      timer t = std::move(timers_.back());
+      timers_.pop_back();
+      ++stats_.timers_fired;
+      ready_.push_back({ t.id, t.due, std::move(t.task) });
+      stats_.max_ready = std::max(stats_.max_ready, ready_.size());
+    }
+  }
+
+  ready_task take(std::size_t i) {
+    ready_task picked = std::move(ready_[i]);
+    if (shuffled_) {
+      // Order among the rest is up to the PRNG anyway.
+      if (i + 1 != ready_.size()) ready_[i] = std::move(ready_.back());
+      ready_.pop_back();
+    } else {
+      ready_.pop_front();
+    }
+    return picked;
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_SIMULATION_HPP_
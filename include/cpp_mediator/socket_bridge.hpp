@@ -0,0 +1,358 @@
+#ifndef HOLDEN_SOCKET_BRIDGE_HPP_
+#define HOLDEN_SOCKET_BRIDGE_HPP_
+
+#include "detail/per_thread.hpp"
+#include "detail/wire.hpp"
+#include "mediator.hpp"
+#include "remote_handler_error.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace holden {
+
+namespace detail {
+
+// Every request and response on a bridge socket is framed by this header,
+// followed by `size` bytes of memcpy-encoded payload.
+struct frame_header {
+  std::uint32_t correlation;
+  std::uint16_t request_index;
+  std::uint16_t status;
+  std::uint32_t size;
+};
+
+enum : std::uint16_t { frame_ok, frame_failed };
+
+constexpr std::size_t socket_buffer_size = 64 * 1024;
+
+inline bool send_all(int fd, const unsigned char* bytes, std::size_t size) {
+  while (size > 0) {
+    const ssize_t n = ::send(fd, bytes, size, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    bytes += n;
+    size -= static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+inline void append_frame(std::vector<unsigned char>& out,
+                         const frame_header& header, const void* payload) {
+  const std::size_t at = out.size();
+  out.resize(at + sizeof(header) + header.size);
+  std::memcpy(&out[at], &header, sizeof(header));
+  if (header.size) std::memcpy(&out[at + sizeof(header)], payload, header.size);
+}
+
+// Feeds each complete frame in `buffer[0, used)` to `on_frame`, then moves
+// any trailing partial frame to the front. Returns the bytes kept.
+template <typename OnFrame>
+std::size_t consume_frames(std::vector<unsigned char>& buffer,
+                           std::size_t used, OnFrame&& on_frame) {
+  std::size_t at = 0;
+  while (used - at >= sizeof(frame_header)) {
+    frame_header header;
+    std::memcpy(&header, &buffer[at], sizeof(header));
+    if (used - at < sizeof(header) + header.size) break;
+    on_frame(header, &buffer[at + sizeof(header)]);
+    at += sizeof(header) + header.size;
+  }
+  std::memmove(buffer.data(), buffer.data() + at, used - at);
+  return used - at;
+}
+
+template <typename Mediator>
+struct sending_handler {
+  Mediator& mediator;
+
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    return mediator.send(r);
+  }
+};
+
+} // namespace detail
+
+// The client end of a Unix domain socket connection to handlers hosted in
+// another process (see `serve_socket`). Like `process_proxy`, a bridge is a
+// handler for `Requests...` and is registered with a mediator in place of
+// the remote handlers.
+//
+// Calls never wait for each other: each request is appended to an outbox
+// and whichever caller finds no write in progress writes out everything
+// queued so far with one `send`, so concurrent callers share syscalls.
+// Responses are read and matched to callers by a background thread, so any
+// number of requests can be in flight. Hold a `batch` to queue several
+// requests from one thread and write them together.
+//
+// Request and response types must be trivially copyable. The bridge owns
+// the socket and closes it on destruction.
+template <typename... Requests>
+class socket_bridge : public request_handler<Requests>... {
+  static_assert(
+      detail::all_of<detail::check_wire_safe<Requests>::value...>::value, "");
+  static_assert(sizeof(detail::frame_header)
+                + detail::max_payload_size<Requests...>::value
+                <= detail::socket_buffer_size,
+                "request too large for a bridge frame");
+
+  struct pending {
+    virtual ~pending() {}
+    virtual void complete(std::uint16_t status, const void* payload) = 0;
+    virtual void fail(std::exception_ptr error) = 0;
+  };
+
+  template <typename TResponse>
+  struct pending_response : pending {
+    std::promise<TResponse> promise;
+
+    void complete(std::uint16_t status, const void* payload) override {
+      if (status != detail::frame_ok) return fail(failure());
+      set(payload, std::is_void<TResponse>());
+    }
+    void fail(std::exception_ptr error) override {
+      promise.set_exception(error);
+    }
+
+   private:
+    void set(const void* payload, std::false_type) {
+      promise.set_value(detail::load<TResponse>(payload));
+    }
+    void set(const void*, std::true_type) { promise.set_value(); }
+  };
+
+  int fd_;
+  std::mutex mutex_;
+  std::vector<unsigned char> outbox_;
+  std::unordered_map<std::uint32_t, std::unique_ptr<pending>> pending_;
+  std::uint32_t next_correlation_ = 0;
+  bool writing_ = false;
+  bool closed_ = false;
+  std::size_t writes_ = 0;
+  detail::per_thread<std::vector<unsigned char>*> batches_ =
+    detail::per_thread<std::vector<unsigned char>*>::make<
+      socket_bridge, &socket_bridge::thread_exited>(this);
+  std::thread reader_;
+
+ public:
+  // Holds back the calling thread's requests until the outermost batch it
+  // opened on this bridge ends, then writes them with one `send`. Other
+  // threads' requests are not held back. A response cannot arrive before
+  // its request is written, so waiting on a future from inside the batch
+  // would never return; `handle`, which waits, writes the batch out first.
+  class batch {
+    socket_bridge& bridge_;
+    std::vector<unsigned char> frames_;
+    bool outermost_;
+
+   public:
+    explicit batch(socket_bridge& bridge) : bridge_(bridge) {
+      outermost_ = bridge_.open_batch() == nullptr;
+      if (outermost_) bridge_.batches_.bind(&frames_);
+    }
+    batch(const batch&) = delete;
+    batch& operator=(const batch&) = delete;
+    ~batch() {
+      if (!outermost_) return;
+      bridge_.batches_.bind(nullptr);
+      bridge_.flush(frames_);
+    }
+  };
+  // Takes ownership of `fd`, a connected stream socket.
+  explicit socket_bridge(int fd) : fd_(fd), reader_([this] { read_loop(); }) {}
+
+  socket_bridge(const socket_bridge&) = delete;
+  socket_bridge& operator=(const socket_bridge&) = delete;
+
+  // Requests still in flight fail with `remote_handler_error`.
+  ~socket_bridge() {
+    ::shutdown(fd_, SHUT_RDWR);
+    reader_.join();
+    ::close(fd_);
+  }
+
+  template <typename TRequest>
+  auto send_async(const TRequest& r)
+  -> std::future<typename TRequest::response_type> {
+    auto p = std::make_unique<
+        pending_response<typename TRequest::response_type>>();
+    auto f = p->promise.get_future();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (closed_) {
+      p->fail(connection_lost());
+      return f;
+    }
+    const std::uint32_t correlation = next_correlation_++;
+    pending_.emplace(correlation, std::move(p));
+    detail::frame_header header{correlation,
+        static_cast<std::uint16_t>(
+            detail::index_of<TRequest, Requests...>::value),
+        detail::frame_ok, static_cast<std::uint32_t>(sizeof(TRequest))};
+    if (auto* frames = open_batch()) {
+      detail::append_frame(*frames, header, &r);
+      return f;
+    }
+    detail::append_frame(outbox_, header, &r);
+    write_outbox(lock);
+    return f;
+  }
+
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    auto response = send_async(r);
+    if (auto* frames = open_batch()) flush(*frames);
+    return response.get();
+  }
+
+  // Number of `send` calls issued so far; each carries one or more frames.
+  std::size_t writes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return writes_;
+  }
+
+ private:
+  void write_outbox(std::unique_lock<std::mutex>& lock) {
+    if (writing_) return;
+    writing_ = true;
+    std::vector<unsigned char> chunk;
+    while (!outbox_.empty() && !closed_) {
+      chunk.swap(outbox_);
+      ++writes_;
+      lock.unlock();
+      const bool sent = detail::send_all(fd_, chunk.data(), chunk.size());
+      chunk.clear();
+      lock.lock();
+      // A failed write leaves the reader to notice the broken connection
+      // and fail everything pending.
+      if (!sent) break;
+    }
+    outbox_.clear();
+    writing_ = false;
+  }
+
+  // The frames held back by the calling thread's batch, if it has one.
+  std::vector<unsigned char>* open_batch() const {
+    std::vector<unsigned char>* frames;
+    return batches_.find(frames) ? frames : nullptr;
+  }
+
+  // Queues the frames held back by a batch and writes them out.
+  void flush(std::vector<unsigned char>& frames) {
+    if (frames.empty()) return;
+    std::unique_lock<std::mutex> lock(mutex_);
+    outbox_.insert(outbox_.end(), frames.begin(), frames.end());
+    frames.clear();
+    write_outbox(lock);
+  }
+
+  // Batches are scoped, so none is open on an exiting thread.
+  static void thread_exited(socket_bridge*, std::vector<unsigned char>*) {}
+
+  void read_loop() {
+    std::vector<unsigned char> buffer(detail::socket_buffer_size);
+    std::size_t used = 0;
+    for (;;) {
+      const ssize_t n = ::recv(fd_, buffer.data() + used,
+                               buffer.size() - used, 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      used += static_cast<std::size_t>(n);
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      used = detail::consume_frames(buffer, used,
+          [this](const detail::frame_header& header, const void* payload) {
+            auto it = pending_.find(header.correlation);
+            if (it == pending_.end()) return;
+            it->second->complete(header.status, payload);
+            pending_.erase(it);
+          });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    for (auto& p : pending_) p.second->fail(connection_lost());
+    pending_.clear();
+  }
+
+  static std::exception_ptr failure() {
+    return std::make_exception_ptr(
+        remote_handler_error("request handler threw in hosting process"));
+  }
+
+  static std::exception_ptr connection_lost() {
+    return std::make_exception_ptr(
+        remote_handler_error("connection to request handler lost"));
+  }
+};
+
+// Serves requests arriving from a `socket_bridge<Requests...>` on `fd` by
+// sending them through `m`, until the peer disconnects. Every frame in a
+// read is handled before any response is written, and all their responses
+// go out together in one `send`.
+template <typename... Requests, typename Mediator>
+void serve_socket(int fd, Mediator& m) {
+  using handler_t = detail::sending_handler<Mediator>;
+  static const detail::encoded_handler_fn<handler_t> handlers[] = {
+    &detail::handle_encoded<Requests, handler_t>...
+  };
+  static constexpr std::size_t response_sizes[] = {
+    detail::wire_size<typename Requests::response_type>::value...
+  };
+
+  handler_t handler{m};
+  std::vector<unsigned char> in(detail::socket_buffer_size);
+  std::vector<unsigned char> out;
+  alignas(std::max_align_t) unsigned char response[
+      detail::max_payload_size<Requests...>::value + 1];
+  std::size_t used = 0;
+
+  for (;;) {
+    const ssize_t n = ::recv(fd, in.data() + used, in.size() - used, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return;
+    used += static_cast<std::size_t>(n);
+
+    used = detail::consume_frames(in, used,
+        [&](const detail::frame_header& header, const void* payload) {
+          detail::frame_header reply = header;
+          reply.size = 0;
+          if (header.request_index >= sizeof...(Requests)) {
+            reply.status = detail::frame_failed;
+          } else {
+            try {
+              handlers[header.request_index](handler, payload, response);
+              reply.size = static_cast<std::uint32_t>(
+                  response_sizes[header.request_index]);
+            } catch (...) {
+              reply.status = detail::frame_failed;
+            }
+          }
+          detail::append_frame(out, reply, response);
+        });
+
+    if (!detail::send_all(fd, out.data(), out.size())) return;
+    out.clear();
+  }
+}
+
+} // namespace holden
+
+#endif // HOLDEN_SOCKET_BRIDGE_HPP_
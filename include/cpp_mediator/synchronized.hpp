@@ -0,0 +1,98 @@
+#ifndef HOLDEN_SYNCHRONIZED_HPP_
+#define HOLDEN_SYNCHRONIZED_HPP_
+
+#include "detail/dispatch_state.hpp"
+#include "detail/lock_order.hpp"
+
+#include <mutex>
+#include <stdexcept>
+#include <typeinfo>
+
+// Lock order checking defaults to on in debug builds.
+#if !defined(HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS)
+#if defined(NDEBUG)
+#define HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS 0
+#else
+#define HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS 1
+#endif
+#endif
+
+namespace holden {
+
+// Serialises calls to a handler that is shared between threads. Register it
+// with a mediator in place of the handler itself:
+//
+//   synchronized<Inventory> inventory(raw_inventory);
+//   auto m = make_mediator(inventory, orders);
+//
+// A send made from inside the handler's own `handle`, on the same thread,
+// runs inline instead of deadlocking on the lock it already holds. Fibers
+// (fiber.hpp) count as separate callers: one waiting for the lock lets the
+// others run. In debug builds every lock taken while another handler's lock
+// is held is recorded, and a pair of handlers locked in both orders is
+// reported through `set_lock_order_violation_handler`.
+template <typename Handler>
+class synchronized {
+  Handler& handler_;
+  std::mutex mutex_;
+
+ public:
+  using handler_type = Handler;
+
+  explicit synchronized(Handler& handler) : handler_(handler) {
+#if HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS
+    detail::lock_order_graph::instance().name(this, typeid(Handler).name());
+#endif
+  }
+
+  synchronized(const synchronized&) = delete;
+  synchronized& operator=(const synchronized&) = delete;
+
+  ~synchronized() {
+#if HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS
+    detail::lock_order_graph::instance().forget(this);
+#endif
+  }
+
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    auto& state = detail::this_thread_dispatch();
+    detail::dispatch_frame frame(state);
+    if (state.holds(this)) return handler_.handle(r);
+    // Past this many the lock could not be recognised on a nested send,
+    // which would then deadlock.
+    if (!state.can_hold_more()) {
+      throw std::length_error(
+          "holden::synchronized: too many handler locks held at once");
+    }
+
+#if HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS
+    for (std::size_t i = 0; i < state.held_count; ++i) {
+      detail::lock_order_graph::instance().on_acquire(state.held[i], this);
+    }
+#endif
+
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    while (!lock.owns_lock()) {
+      // On a fiber the holder may be another fiber of this thread, which
+      // can only release the lock if this one lets it run.
+      if (!state.yield_fiber) {
+        lock.lock();
+        break;
+      }
+      state.yield_fiber(state.fiber_scheduler);
+      lock.try_lock();
+    }
+    struct held_guard {
+      detail::dispatch_state& state;
+      const void* lock;
+      ~held_guard() { state.pop_held(lock); }
+    } held{state, this};
+    state.push_held(this);
+    return handler_.handle(r);
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_SYNCHRONIZED_HPP_
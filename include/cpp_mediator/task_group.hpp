@@ -0,0 +1,121 @@
+#ifndef HOLDEN_TASK_GROUP_HPP_
+#define HOLDEN_TASK_GROUP_HPP_
+
+#include "detail/futex.hpp"
+#include "result.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace holden {
+
+// The error a task group's child completes with when the group was
+// cancelled before the child's request was handled.
+class task_cancelled : public std::runtime_error {
+ public:
+  task_cancelled() : std::runtime_error("task group cancelled") {}
+};
+
+// Scopes a fan-out of async sends on a dispatcher: every child spawned
+// through the group has finished by the time `wait()` returns, and the
+// destructor waits too, so no child outlives the group (or the state its
+// continuations refer to).
+//
+//   task_group<decltype(d)> group(d);
+//   for (auto& shard : shards)
+//     group.spawn(Query{shard}, [&](result<Rows> r) { merge(r.value()); });
+//   group.wait();
+//
+// Bookkeeping is one atomic counter; children are queued with `execute`,
+// so nothing is allocated per child beyond what the dispatcher's queue
+// slot already holds. Waiting sleeps on a futex on the counter and costs
+// the children nothing unless someone is actually waiting.
+template <typename Dispatcher>
+class task_group {
+  static constexpr std::uint32_t waiter_bit = 1u << 31;
+  static constexpr std::uint32_t count_mask = waiter_bit - 1;
+
+  Dispatcher& dispatcher_;
+  std::atomic<std::uint32_t> pending_{0};
+  std::atomic<bool> cancelled_{false};
+
+  struct completion_guard {
+    task_group* group;
+    ~completion_guard() { group->child_done(); }
+  };
+
+ public:
+  explicit task_group(Dispatcher& d) : dispatcher_(d) {}
+
+  task_group(const task_group&) = delete;
+  task_group& operator=(const task_group&) = delete;
+
+  ~task_group() { wait(); }
+
+  // Sends `r` on the dispatcher and hands the outcome to `continuation` on
+  // the dispatcher's thread. If the group is cancelled before the request
+  // is handled, it is skipped and `continuation` gets `task_cancelled`.
+  template <typename TRequest, typename Continuation>
+  void spawn(TRequest r, Continuation continuation) {
+    using response_t = typename TRequest::response_type;
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    dispatcher_.execute([this, r = std::move(r),
+                         continuation = std::move(continuation)]() mutable {
+      // The dispatcher destroys the task itself only later, so the request
+      // and continuation are moved out to go before the group is told.
+      completion_guard guard{this};
+      TRequest request = std::move(r);
+      Continuation done = std::move(continuation);
+      if (cancelled()) {
+        done(result<response_t>(std::make_exception_ptr(task_cancelled())));
+        return;
+      }
+      done(detail::capture(
+          [&] { return dispatcher_.mediator().send(request); }));
+    });
+  }
+
+  // As above, discarding the response.
+  template <typename TRequest>
+  void spawn(TRequest r) {
+    spawn(std::move(r), [](result<typename TRequest::response_type>) {});
+  }
+
+  // Children whose requests have not been handled yet are skipped.
+  void cancel() { cancelled_.store(true, std::memory_order_release); }
+
+  bool cancelled() const { return cancelled_.load(std::memory_order_acquire); }
+
+  // Children spawned but not yet finished.
+  std::uint32_t pending() const {
+    return pending_.load(std::memory_order_acquire) & count_mask;
+  }
+
+  // Blocks until every child spawned so far has finished.
+  void wait() {
+    for (;;) {
+      std::uint32_t seen = pending_.load(std::memory_order_acquire);
+      if ((seen & count_mask) == 0) break;
+      if (!(seen & waiter_bit)
+          && !pending_.compare_exchange_weak(seen, seen | waiter_bit,
+                                             std::memory_order_acq_rel))
+        continue;
+      detail::futex_wait(pending_, seen | waiter_bit);
+    }
+    pending_.fetch_and(count_mask, std::memory_order_relaxed);
+  }
+
+ private:
+  void child_done() {
+    const auto before = pending_.fetch_sub(1, std::memory_order_acq_rel);
+    if ((before & count_mask) == 1 && (before & waiter_bit))
+      detail::futex_wake(pending_, INT32_MAX);
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_TASK_GROUP_HPP_
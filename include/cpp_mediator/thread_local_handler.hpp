@@ -0,0 +1,127 @@
+#ifndef HOLDEN_THREAD_LOCAL_HANDLER_HPP_
+#define HOLDEN_THREAD_LOCAL_HANDLER_HPP_
+
+#include "detail/per_thread.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace holden {
+
+// Registers a handler with a mediator so that every thread sending through
+// it gets its own instance, copied from `prototype` on the thread's first
+// send. Sends never share an instance, so they take no lock and do not
+// contend; suited to handlers whose state is cheap to duplicate (parsers,
+// formatters, scratch buffers) or can be merged.
+//
+//   thread_local_handler<Parser> parsers(Parser(config));
+//   auto m = make_mediator(parsers, other_handler);
+//
+// With `merge` given, each thread calls `merge(its_instance)` itself after
+// every `merge_every` sends (if not zero) and once more when it exits, so
+// the merge never races the instance's own sends; it must synchronise
+// whatever it merges into, and must not send through the mediator, as it
+// may run while the thread is exiting. An instance is destroyed when its
+// thread exits; those of threads still running when the slot is destroyed
+// are merged by the destroying thread first. Without `merge`,
+// `merge_every` is ignored.
+template <typename Handler>
+class thread_local_handler {
+  struct instance {
+    Handler handler;
+    std::size_t sends_since_merge;
+  };
+
+  const Handler prototype_;
+  const std::size_t merge_every_;
+  const std::function<void(Handler&)> merge_;
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<instance>> instances_;
+  detail::per_thread<instance*> locals_ =
+    detail::per_thread<instance*>::template make<
+      thread_local_handler, &thread_local_handler::thread_exited>(this);
+
+ public:
+  using handler_type = Handler;
+
+  explicit thread_local_handler(Handler prototype = Handler(),
+                                std::size_t merge_every = 0,
+                                std::function<void(Handler&)> merge = {})
+    : prototype_(std::move(prototype)), merge_every_(merge ? merge_every : 0),
+      merge_(std::move(merge)) {}
+
+  ~thread_local_handler() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (merge_) {
+      for (auto& i : instances_) merge_(i->handler);
+    }
+    instances_.clear();
+  }
+
+  thread_local_handler(const thread_local_handler&) = delete;
+  thread_local_handler& operator=(const thread_local_handler&) = delete;
+
+  template <typename TRequest>
+  auto handle(const TRequest& r) -> typename TRequest::response_type {
+    instance& local = local_instance();
+    if (merge_every_ != 0 && ++local.sends_since_merge > merge_every_) {
+      local.sends_since_merge = 1;
+      merge_(local.handler);
+    }
+    return local.handler.handle(r);
+  }
+
+  // The calling thread's instance, created if need be.
+  Handler& local() { return local_instance().handler; }
+
+  // How many running threads have an instance.
+  std::size_t instance_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return instances_.size();
+  }
+
+  // Calls `f(instance)` for every running thread's instance, in creation
+  // order. Not synchronised with sends in progress on other threads.
+  template <typename F>
+  void for_each(F&& f) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& i : instances_) f(i->handler);
+  }
+
+ private:
+  instance& local_instance() {
+    instance* local;
+    if (locals_.find(local)) return *local;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      instances_.emplace_back(new instance{prototype_, 0});
+      local = instances_.back().get();
+    }
+    locals_.bind(local);
+    return *local;
+  }
+
+  static void thread_exited(thread_local_handler* self, instance* local) {
+    std::unique_ptr<instance> owned;
+    {
+      std::lock_guard<std::mutex> lock(self->mutex_);
+      auto& all = self->instances_;
+      for (auto it = all.begin(); it != all.end(); ++it) {
+        if (it->get() != local) continue;
+        owned = std::move(*it);
+        all.erase(it);
+        break;
+      }
+    }
+    if (owned && self->merge_) self->merge_(owned->handler);
+  }
+};
+
+} // namespace holden
+
+#endif // HOLDEN_THREAD_LOCAL_HANDLER_HPP_
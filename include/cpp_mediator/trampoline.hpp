@@ -0,0 +1,67 @@
+#ifndef HOLDEN_TRAMPOLINE_HPP_
+#define HOLDEN_TRAMPOLINE_HPP_
+
+#include "detail/task.hpp"
+
+#include <deque>
+#include <utility>
+
+namespace holden {
+
+namespace detail {
+
+struct trampoline_state {
+  bool running = false;
+  std::deque<task> pending;
+};
+
+inline trampoline_state& this_thread_trampoline() {
+  static thread_local trampoline_state state;
+  return state;
+}
+
+} // namespace detail
+
+// Sends `r` through `m` as a tail call: the caller does not wait for the
+// response, which is discarded.
+//
+// The first tail call on a thread becomes a trampoline: it handles `r`, then
+// keeps handling whatever tail calls that queued, one after another, until
+// none are left. Tail calls made while a trampoline is running are only
+// queued on it, so a chain of handlers that each tail-call the next runs in
+// constant stack depth however long it is:
+//
+//   void handle(const Step& s) {
+//     if (s.remaining > 0) holden::send_tail(m, Step{s.remaining - 1});
+//   }
+//
+// Tail calls run in the order they were made. If one throws, the calls still
+// queued are dropped and the exception reaches the trampoline's caller.
+template <typename Mediator, typename TRequest>
+void send_tail(Mediator& m, TRequest r) {
+  auto& state = detail::this_thread_trampoline();
+  if (state.running) {
+    state.pending.emplace_back([&m, r = std::move(r)] { m.send(r); });
+    return;
+  }
+
+  struct unwind {
+    detail::trampoline_state& state;
+    ~unwind() {
+      state.running = false;
+      state.pending.clear();
+    }
+  } guard{state};
+  state.running = true;
+
+  m.send(r);
+  while (!state.pending.empty()) {
+    detail::task next = std::move(state.pending.front());
+    state.pending.pop_front();
+    next();
+  }
+}
+
+} // namespace holden
+
+#endif // HOLDEN_TRAMPOLINE_HPP_
@@ -0,0 +1,66 @@
+#include "../include/cpp_mediator/child_mediator.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/mediator_ref.hpp"
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+struct Quota : holden::request<int> {};
+struct User : holden::request<std::string> {};
+
+class GlobalQuota : holden::request_handler<Quota> {
+ public:
+  int handle(const Quota&) { return 10; }
+};
+
+class Users : holden::request_handler<User> {
+ public:
+  int calls = 0;
+  std::string handle(const User&) { ++calls; return "alice"; }
+};
+
+class TenantQuota : holden::request_handler<Quota> {
+ public:
+  int limit;
+  explicit TenantQuota(int l) : limit(l) {}
+  int handle(const Quota&) { return limit; }
+};
+
+} // namespace
+
+TEST(child_mediator, own_handlers_shadow_the_parent) {
+  GlobalQuota global{};
+  Users users{};
+  auto service = holden::make_mediator(global, users);
+
+  TenantQuota tenant_quota(3);
+  auto tenant = holden::make_child_mediator(service, tenant_quota);
+  static_assert(decltype(tenant)::handles<Quota>(), "");
+  static_assert(!decltype(tenant)::handles<User>(), "");
+
+  ASSERT_EQ(3, tenant.send(Quota{}));
+  ASSERT_EQ("alice", tenant.send(User{}));
+  ASSERT_EQ(1, users.calls);
+  ASSERT_EQ(10, service.send(Quota{}));
+}
+
+TEST(child_mediator, nests_and_erases_like_any_mediator) {
+  GlobalQuota global{};
+  Users users{};
+  auto service = holden::make_mediator(global, users);
+
+  TenantQuota tenant_quota(3);
+  TenantQuota request_quota(1);
+  auto tenant = holden::make_child_mediator(service, tenant_quota);
+  auto scoped = holden::make_child_mediator(tenant, request_quota);
+
+  ASSERT_EQ(1, scoped.send(Quota{}));
+  ASSERT_EQ("alice", scoped.send(User{}));
+  ASSERT_EQ(&service, &tenant.parent());
+
+  holden::mediator_ref<Quota, User> ref(scoped);
+  ASSERT_EQ(1, ref.send(Quota{}));
+  ASSERT_EQ("alice", ref.send(User{}));
+}
@@ -0,0 +1,39 @@
+# Compiles many_requests.cc with few and with many request types and fails
+# if the code each extra request type adds (`.text*` sections of the object
+# file) exceeds BUDGET bytes.
+#
+# cmake -DCXX=<compiler> -DSOURCE=<many_requests.cc> -DWORK_DIR=<dir>
+#       -DOPT=<-O0|-O2|...> -DBUDGET=<bytes> -P code_size.cmake
+
+set(FEW 10)
+set(MANY 500)
+
+function(text_size requests out)
+  set(object ${WORK_DIR}/many_requests_${requests}${OPT}.o)
+  execute_process(
+    COMMAND ${CXX} -std=c++14 ${OPT} -DREQUESTS=${requests} -c ${SOURCE} -o ${object}
+    RESULT_VARIABLE failed)
+  if (failed)
+    message(FATAL_ERROR "cannot compile ${SOURCE} with ${requests} requests")
+  endif()
+  execute_process(COMMAND size -A ${object} OUTPUT_VARIABLE sections)
+  string(REGEX MATCHALL "\n\\.text[^ \t]*[ \t]+[0-9]+" text_sections "${sections}")
+  set(total 0)
+  foreach(section ${text_sections})
+    string(REGEX MATCH "[0-9]+$" bytes "${section}")
+    math(EXPR total "${total} + ${bytes}")
+  endforeach()
+  set(${out} ${total} PARENT_SCOPE)
+endfunction()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+text_size(${FEW} few_text)
+text_size(${MANY} many_text)
+math(EXPR per_request "(${many_text} - ${few_text}) / (${MANY} - ${FEW})")
+message("${OPT}: ${few_text} bytes of .text with ${FEW} requests, "
+        "${many_text} with ${MANY}: ${per_request} bytes per request "
+        "(budget ${BUDGET})")
+if (per_request GREATER BUDGET)
+  message(FATAL_ERROR "each request type costs ${per_request} bytes of code, "
+                      "over the budget of ${BUDGET}")
+endif()
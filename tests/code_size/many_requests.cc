@@ -0,0 +1,74 @@
+// A mediator with REQUESTS request types spread over HANDLERS handlers, and
+// one out-of-line function per request type that sends it. Compiled at two
+// request counts by code_size.cmake to measure the code each additional
+// request type costs, and by benchmarks/compile_time.sh to time handler
+// lookup (with NO_MARKERS, in C++20, through the concept check alone).
+
+#include "../../include/cpp_mediator/mediator.hpp"
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+#ifndef REQUESTS
+#define REQUESTS 500
+#endif
+#define HANDLERS 10
+
+namespace {
+
+template <std::size_t I>
+struct Req : holden::request<std::size_t> {};
+
+template <std::size_t K, typename Is>
+struct Handler;
+
+#if defined(NO_MARKERS)
+// Handlers found through the C++20 concept check alone.
+template <std::size_t K, std::size_t... Is>
+struct Handler<K, std::index_sequence<Is...>> {
+  std::size_t calls = 0;
+
+  template <std::size_t I>
+    requires ((I == Is * HANDLERS + K) || ...)
+  std::size_t handle(const Req<I>&) { return calls += I; }
+};
+#else
+template <std::size_t K, std::size_t... Is>
+struct Handler<K, std::index_sequence<Is...>>
+  : holden::request_handler<Req<Is * HANDLERS + K>>... {
+  std::size_t calls = 0;
+
+  template <std::size_t I>
+  std::size_t handle(const Req<I>&) { return calls += I; }
+};
+#endif
+
+template <std::size_t K>
+using handler_t = Handler<K, std::make_index_sequence<REQUESTS / HANDLERS>>;
+
+template <typename Ks>
+struct Handlers;
+
+template <std::size_t... Ks>
+struct Handlers<std::index_sequence<Ks...>> {
+  std::tuple<handler_t<Ks>...> handlers;
+  holden::mediator<handler_t<Ks>&...> mediator{std::get<Ks>(handlers)...};
+};
+
+Handlers<std::make_index_sequence<HANDLERS>> all;
+
+template <std::size_t I>
+std::size_t send_one() { return all.mediator.send(Req<I>{}); }
+
+template <std::size_t... Is>
+constexpr std::array<std::size_t (*)(), sizeof...(Is)>
+table(std::index_sequence<Is...>) {
+  return {{ &send_one<Is>... }};
+}
+
+} // namespace
+
+extern const std::array<std::size_t (*)(), REQUESTS> senders =
+    table(std::make_index_sequence<REQUESTS>());
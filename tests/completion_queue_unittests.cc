@@ -0,0 +1,110 @@
+#include "../include/cpp_mediator/completion_queue.hpp"
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+
+#include <poll.h>
+#if defined(__linux__)
+#include <sys/epoll.h>
+#endif
+
+namespace {
+
+struct Square : holden::request<int> {
+  int x;
+  explicit Square(int _x) : x(_x) {}
+};
+
+struct Touch : holden::request<void> {};
+
+class Squarer
+  : holden::request_handler<Square>
+  , holden::request_handler<Touch> {
+ public:
+  int handle(const Square& r) {
+    if (r.x < 0) throw std::domain_error("negative");
+    return r.x * r.x;
+  }
+  void handle(const Touch&) {}
+};
+
+bool readable(int fd) {
+  pollfd p{fd, POLLIN, 0};
+  return ::poll(&p, 1, 0) == 1;
+}
+
+} // namespace
+
+TEST(completion_queue, signals_once_per_burst) {
+  holden::completion_queue<> cq;
+  ASSERT_FALSE(readable(cq.native_handle()));
+
+  int ran = 0;
+  for (int i = 0; i < 3; ++i) cq.post([&] { ++ran; });
+  ASSERT_TRUE(readable(cq.native_handle()));
+
+  ASSERT_EQ(3u, cq.drain());
+  ASSERT_EQ(3, ran);
+  ASSERT_FALSE(readable(cq.native_handle()));
+}
+
+TEST(completion_queue, partial_drain_stays_readable) {
+  holden::completion_queue<> cq;
+  int ran = 0;
+  for (int i = 0; i < 3; ++i) cq.post([&] { ++ran; });
+
+  ASSERT_EQ(2u, cq.drain(2));
+  ASSERT_TRUE(readable(cq.native_handle()));
+  ASSERT_EQ(1u, cq.drain(2));
+  ASSERT_FALSE(readable(cq.native_handle()));
+  ASSERT_EQ(3, ran);
+}
+
+#if defined(__linux__)
+TEST(completion_queue, completions_run_on_epoll_loop_thread) {
+  Squarer s{};
+  auto m = holden::make_mediator(s);
+  holden::dispatcher<decltype(m)> d(m);
+  holden::completion_queue<> cq;
+
+  const int ep = ::epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_GE(ep, 0);
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ASSERT_EQ(0, ::epoll_ctl(ep, EPOLL_CTL_ADD, cq.native_handle(), &ev));
+
+  const auto loop_thread = std::this_thread::get_id();
+  const int requests = 100;
+  int sum = 0, completed = 0, failures = 0;
+  for (int i = 0; i < requests; ++i) {
+    d.send_async(Square{i}, cq, [&](holden::result<int> r) {
+      ASSERT_EQ(loop_thread, std::this_thread::get_id());
+      sum += r.value();
+      ++completed;
+    });
+  }
+  d.send_async(Square{-1}, cq, [&](holden::result<int> r) {
+    ASSERT_FALSE(r.has_value());
+    ASSERT_THROW(r.value(), std::domain_error);
+    ++failures;
+  });
+  d.send_async(Touch{}, cq, [&](holden::result<void> r) {
+    ASSERT_TRUE(r.has_value());
+    ++completed;
+  });
+
+  while (completed + failures < requests + 2) {
+    epoll_event ready{};
+    ASSERT_EQ(1, ::epoll_wait(ep, &ready, 1, 5000));
+    cq.drain();
+  }
+  ::close(ep);
+
+  ASSERT_EQ(requests + 1, completed);
+  ASSERT_EQ(1, failures);
+  ASSERT_EQ(328350, sum);
+}
+#endif
@@ -0,0 +1,61 @@
+// Built only by the C++20 test target (tests_cxx20).
+
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/synchronized.hpp"
+#include <gtest/gtest.h>
+
+#include <string>
+
+static_assert(HOLDEN_MEDIATOR_CONCEPTS, "this test needs C++20 concepts");
+
+namespace {
+
+struct Ping : holden::request<int> {};
+
+struct Rename : holden::request<std::string> {
+  std::string name;
+  explicit Rename(std::string n) : name(std::move(n)) {}
+};
+
+// No marker bases: found by its `handle` overloads alone.
+struct Plain {
+  int pings = 0;
+  int handle(const Ping&) { return ++pings; }
+  std::string handle(const Rename& r) { return "renamed " + r.name; }
+};
+
+// Accepts anything, so it only ever wins where no handler is marked.
+struct Fallback {
+  template <typename TRequest>
+  typename TRequest::response_type handle(const TRequest&) { return {}; }
+};
+
+class MarkedPing : holden::request_handler<Ping> {
+ public:
+  int handle(const Ping&) { return 42; }
+};
+
+} // namespace
+
+TEST(concepts, handlers_need_no_marker_base) {
+  Plain plain;
+  auto m = holden::make_mediator(plain);
+  ASSERT_EQ(1, m.send(Ping{}));
+  ASSERT_EQ(2, m.send(Ping{}));
+  ASSERT_EQ("renamed x", m.send(Rename{"x"}));
+}
+
+TEST(concepts, marked_handler_wins_over_generic_handle) {
+  Fallback fallback;
+  MarkedPing marked;
+  auto m = holden::make_mediator(fallback, marked);
+  ASSERT_EQ(42, m.send(Ping{}));
+  ASSERT_EQ("", m.send(Rename{"x"}));
+}
+
+TEST(concepts, wrappers_are_matched_by_the_wrapped_handler) {
+  Plain plain;
+  holden::synchronized<Plain> shared(plain);
+  auto m = holden::make_mediator(shared);
+  ASSERT_EQ(1, m.send(Ping{}));
+}
@@ -0,0 +1,177 @@
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace {
+
+struct Add : holden::request<int> {
+  int x, y;
+  Add(int _x, int _y) : x(_x), y(_y) {}
+};
+
+struct Record : holden::request<void> {
+  int value;
+  explicit Record(int v) : value(v) {}
+};
+
+struct Fail : holden::request<int> {};
+
+class Calculator
+  : holden::request_handler<Add>
+  , holden::request_handler<Record>
+  , holden::request_handler<Fail> {
+ public:
+  std::vector<int> recorded;
+  std::thread::id last_thread;
+
+  int handle(const Add& r) {
+    last_thread = std::this_thread::get_id();
+    return r.x + r.y;
+  }
+  void handle(const Record& r) { recorded.push_back(r.value); }
+  int handle(const Fail&) { throw std::runtime_error("failed"); }
+};
+
+template <typename WaitPolicy>
+void expect_round_trips(WaitPolicy policy, int count) {
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  holden::dispatcher<decltype(m), WaitPolicy> d(m, policy);
+
+  for (int i = 0; i < count; ++i)
+    ASSERT_EQ(i + 1, d.send_async(Add{i, 1}).get());
+  ASSERT_NE(std::this_thread::get_id(), c.last_thread);
+}
+
+} // namespace
+
+TEST(dispatcher, park_wait_round_trip) {
+  expect_round_trips(holden::park_wait{}, 100);
+}
+
+TEST(dispatcher, busy_poll_round_trip) {
+  expect_round_trips(holden::busy_poll_wait{}, 10);
+}
+
+TEST(dispatcher, spin_then_park_round_trip) {
+  expect_round_trips(holden::spin_then_park_wait{}, 100);
+}
+
+TEST(dispatcher, spin_budget_adapts) {
+  holden::detail::event_count wakeup;
+  holden::spin_then_park_wait policy(4, 64);
+
+  policy.idle(wakeup, [] { return true; });
+  ASSERT_EQ(8u, policy.spin_budget());
+  policy.idle(wakeup, [] { return true; });
+  ASSERT_EQ(16u, policy.spin_budget());
+
+  int calls = 0;
+  policy.idle(wakeup, [&] { return ++calls > 16; });
+  ASSERT_EQ(8u, policy.spin_budget());
+}
+
+TEST(dispatcher, runs_requests_in_order_and_drains_on_destruction) {
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  {
+    holden::dispatcher<decltype(m), holden::park_wait, 4> d(m);
+    for (int i = 0; i < 100; ++i) d.send_async(Record{i});
+  }
+  ASSERT_EQ(100u, c.recorded.size());
+  for (int i = 0; i < 100; ++i) ASSERT_EQ(i, c.recorded[std::size_t(i)]);
+}
+
+TEST(dispatcher, many_producers) {
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  holden::dispatcher<decltype(m), holden::spin_then_park_wait, 16> d(m);
+
+  std::vector<std::thread> producers;
+  std::atomic<int> sum{0};
+  for (int t = 0; t < 4; ++t) {
+    producers.emplace_back([&] {
+      for (int i = 0; i < 250; ++i) sum += d.send_async(Add{i, 0}).get();
+    });
+  }
+  for (auto& p : producers) p.join();
+  ASSERT_EQ(4 * (249 * 250 / 2), sum.load());
+}
+
+TEST(dispatcher, propagates_exceptions) {
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  holden::dispatcher<decltype(m)> d(m);
+  auto f = d.send_async(Fail{});
+  ASSERT_THROW(f.get(), std::runtime_error);
+}
+
+#if defined(__linux__)
+TEST(dispatcher, pins_worker_to_cpu) {
+  cpu_set_t allowed;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) ++cpu;
+
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  holden::dispatcher<decltype(m), holden::busy_poll_wait> d(
+      m, holden::busy_poll_wait{}, cpu);
+  ASSERT_EQ(3, d.send_async(Add{1, 2}).get());
+
+  using pinned_t = holden::dispatcher<decltype(m), holden::park_wait>;
+  ASSERT_THROW(pinned_t(m, holden::park_wait{}, CPU_SETSIZE),
+               std::system_error);
+}
+#endif
+
+TEST(dispatcher, send_then_runs_continuation_on_worker) {
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  holden::dispatcher<decltype(m)> d(m);
+
+  std::promise<std::thread::id> continuation_thread;
+  std::promise<int> sum;
+  d.send_then(Add{20, 22}, [&](holden::result<int> r) {
+    continuation_thread.set_value(std::this_thread::get_id());
+    sum.set_value(r.value());
+  });
+  ASSERT_EQ(42, sum.get_future().get());
+  ASSERT_EQ(c.last_thread, continuation_thread.get_future().get());
+
+  std::promise<bool> failed;
+  d.send_then(Fail{}, [&](holden::result<int> r) {
+    failed.set_value(!r.has_value());
+  });
+  ASSERT_TRUE(failed.get_future().get());
+}
+
+TEST(dispatcher, send_then_stores_continuation_inline) {
+  Calculator c{};
+  auto m = holden::make_mediator(c);
+  using small_t = holden::dispatcher<decltype(m)>;
+  using large_t = holden::dispatcher<decltype(m), holden::park_wait, 1024, 112>;
+
+  std::atomic<int> sum{0};
+  auto accumulate = [&sum](holden::result<int> r) { sum += r.value(); };
+  static_assert(small_t::sends_inline<Add, decltype(accumulate)>(),
+                "a pointer-sized continuation fits the default slot");
+
+  struct Bulky { char bytes[80]; void operator()(holden::result<int>) {} };
+  static_assert(!small_t::sends_inline<Add, Bulky>(), "");
+  static_assert(large_t::sends_inline<Add, Bulky>(), "");
+
+  {
+    small_t d(m);
+    for (int i = 0; i < 100; ++i) d.send_then(Add{i, 1}, accumulate);
+  }
+  ASSERT_EQ(5050, sum.load());
+}
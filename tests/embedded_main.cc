@@ -0,0 +1,113 @@
+// Built without exceptions, RTTI or the heap (see CMakeLists.txt): the link
+// fails if anything here, including the inlined library code, references
+// an allocation function. Everything lives in static storage. Exits with
+// the number of failed checks.
+
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/polled_dispatcher.hpp"
+
+#include <cstdint>
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok) {
+  if (!ok) ++failures;
+}
+
+// Two independent mediators, so the size report has something to compare.
+
+struct ReadAdc : holden::request<std::uint16_t> {
+  std::uint8_t channel;
+  explicit ReadAdc(std::uint8_t c) : channel(c) {}
+};
+
+struct Calibrate : holden::request<void> {
+  std::int16_t offset;
+  explicit Calibrate(std::int16_t o) : offset(o) {}
+};
+
+class Adc
+  : holden::request_handler<ReadAdc>
+  , holden::request_handler<Calibrate> {
+  std::int16_t offset_ = 0;
+
+ public:
+  std::uint16_t handle(const ReadAdc& r) {
+    return static_cast<std::uint16_t>(r.channel * 100 + offset_);
+  }
+  void handle(const Calibrate& c) { offset_ = c.offset; }
+};
+
+struct SetDuty : holden::request<bool> {
+  std::uint8_t percent;
+  explicit SetDuty(std::uint8_t p) : percent(p) {}
+};
+
+class Pwm : holden::request_handler<SetDuty> {
+ public:
+  std::uint8_t duty = 0;
+  bool handle(const SetDuty& r) {
+    if (r.percent > 100) return false;
+    duty = r.percent;
+    return true;
+  }
+};
+
+Adc adc;
+Pwm pwm;
+holden::mediator<Adc&> sensors(adc);
+holden::mediator<Pwm&> actuators(pwm);
+holden::polled_dispatcher<holden::mediator<Adc&>, 8> sensor_queue(sensors);
+holden::polled_dispatcher<holden::mediator<Pwm&>, 4, 32> actuator_queue(
+    actuators);
+
+std::uint32_t adc_sum = 0;
+int rejected_duties = 0;
+
+void test_direct_sends() {
+  check(sensors.send(ReadAdc{2}) == 200);
+  check(actuators.send(SetDuty{40}));
+  check(pwm.duty == 40);
+}
+
+void test_queued_sends_run_on_poll() {
+  sensor_queue.try_send_then(Calibrate{5}, [](holden::result<void> r) {
+    check(r.has_value());
+  });
+  for (std::uint8_t c = 0; c < 4; ++c) {
+    sensor_queue.try_send_then(ReadAdc{c}, [](holden::result<std::uint16_t> r) {
+      adc_sum += r.value();
+    });
+  }
+  check(adc_sum == 0);
+  check(sensor_queue.poll() == 5);
+  check(adc_sum == 0 + 100 + 200 + 300 + 4 * 5);
+  check(sensor_queue.empty());
+}
+
+void test_full_queue_is_reported() {
+  auto then = [](holden::result<bool> r) {
+    if (!r.value()) ++rejected_duties;
+  };
+  int accepted = 0;
+  while (actuator_queue.try_send_then(SetDuty{150}, then)) ++accepted;
+  check(accepted == 4);
+  check(actuator_queue.poll(3) == 3);
+  check(actuator_queue.poll() == 1);
+  check(rejected_duties == 4);
+}
+
+static_assert(
+    decltype(actuator_queue)::sends_inline<SetDuty, void (*)(holden::result<bool>)>(),
+    "a send and a function pointer fit a 32 byte slot");
+
+} // namespace
+
+int main() {
+  test_direct_sends();
+  test_queued_sends_run_on_poll();
+  test_full_queue_is_reported();
+  return failures;
+}
@@ -0,0 +1,141 @@
+#include "../include/cpp_mediator/epoch.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> live_tables{0};
+
+struct Table {
+  std::vector<int> rows;
+
+  explicit Table(std::vector<int> r) : rows(std::move(r)) { ++live_tables; }
+  ~Table() { --live_tables; }
+};
+
+struct GetRows : holden::request<holden::epoch_view<int>> {};
+struct GetRow : holden::request<holden::epoch_view<int>> {
+  std::size_t index;
+  explicit GetRow(std::size_t i) : index(i) {}
+};
+struct SetRows : holden::request<void> {
+  std::vector<int> rows;
+  explicit SetRows(std::vector<int> r) : rows(std::move(r)) {}
+};
+
+class TableHandler
+  : holden::request_handler<GetRows>
+  , holden::request_handler<GetRow>
+  , holden::request_handler<SetRows> {
+  holden::epoch_ptr<Table> table_;
+
+ public:
+  explicit TableHandler(holden::epoch_domain& domain)
+    : table_(domain, std::unique_ptr<Table>(new Table({}))) {}
+
+  holden::epoch_view<int> handle(const GetRows&) {
+    auto table = table_.view();
+    const auto& rows = table->rows;
+    return std::move(table).project(rows.data(), rows.size());
+  }
+
+  holden::epoch_view<int> handle(const GetRow& q) {
+    auto table = table_.view();
+    return std::move(table).project(&table->rows.at(q.index));
+  }
+
+  void handle(const SetRows& s) {
+    table_.reset(std::unique_ptr<Table>(new Table(s.rows)));
+  }
+};
+
+} // namespace
+
+TEST(epoch, retired_objects_outlive_pinned_views) {
+  holden::epoch_domain domain;
+  {
+    TableHandler handler(domain);
+    auto m = holden::make_mediator(handler);
+
+    m.send(SetRows({1, 2, 3}));
+    auto view = m.send(GetRows());
+    ASSERT_EQ(3u, view.size());
+
+    m.send(SetRows({4, 5}));
+    domain.reclaim();
+    ASSERT_EQ(2, live_tables.load());  // the viewed table is still alive
+    ASSERT_EQ(1, view[0]);
+    ASSERT_EQ(3, view[2]);
+
+    auto row = m.send(GetRow(1));
+    ASSERT_EQ(5, *row);
+
+    view = holden::epoch_view<int>();
+    row = holden::epoch_view<int>();
+    domain.reclaim();
+    ASSERT_EQ(1, live_tables.load());
+    ASSERT_EQ(0u, domain.pending());
+  }
+  domain.reclaim();
+  ASSERT_EQ(0, live_tables.load());
+}
+
+TEST(epoch, pins_nest_and_move_between_threads) {
+  holden::epoch_domain domain;
+  auto outer = domain.pin();
+  auto inner = domain.pin();
+  domain.retire(new Table({1}));
+
+  inner.reset();
+  ASSERT_EQ(0u, domain.reclaim());
+
+  std::thread([&, g = std::move(outer)]() mutable { g.reset(); }).join();
+  ASSERT_EQ(1u, domain.reclaim());
+  ASSERT_EQ(0, live_tables.load());
+}
+
+TEST(epoch, readers_never_see_freed_state) {
+  holden::epoch_domain domain(8);
+  {
+    TableHandler handler(domain);
+    auto m = holden::make_mediator(handler);
+    m.send(SetRows(std::vector<int>(64, 0)));
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+      readers.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+          auto rows = m.send(GetRows());
+          // Every table is uniform; a torn or freed one would not be.
+          for (int v : rows) ASSERT_EQ(rows[0], v);
+        }
+      });
+    }
+    for (int i = 1; i <= 2000; ++i) m.send(SetRows(std::vector<int>(64, i)));
+    stop = true;
+    for (auto& t : readers) t.join();
+  }
+  domain.reclaim();
+  ASSERT_EQ(0, live_tables.load());
+}
+
+TEST(epoch, recycled_records_keep_pins_of_moved_guards) {
+  holden::epoch_domain domain;
+  holden::epoch_guard kept;
+  std::thread([&] { kept = domain.pin(); }).join();
+  domain.retire(new Table({1}));
+
+  // This thread takes over the exited thread's record.
+  std::thread([&] { domain.pin().reset(); }).join();
+  ASSERT_EQ(0u, domain.reclaim());
+
+  kept.reset();
+  ASSERT_EQ(1u, domain.reclaim());
+  ASSERT_EQ(0, live_tables.load());
+}
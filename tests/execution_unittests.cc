@@ -0,0 +1,174 @@
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/execution.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace ex = holden::execution;
+
+namespace {
+
+struct Lookup : holden::request<std::string> {
+  int id;
+  explicit Lookup(int i) : id(i) {}
+};
+
+struct Count : holden::request<int> {};
+
+struct Touch : holden::request<void> {};
+
+struct Broken : holden::request<int> {};
+
+class Directory
+  : holden::request_handler<Lookup>
+  , holden::request_handler<Count>
+  , holden::request_handler<Touch>
+  , holden::request_handler<Broken> {
+ public:
+  std::thread::id last_thread;
+  int touches = 0;
+
+  std::string handle(const Lookup& r) {
+    last_thread = std::this_thread::get_id();
+    return "user" + std::to_string(r.id);
+  }
+  int handle(const Count&) { return 3; }
+  void handle(const Touch&) { ++touches; }
+  int handle(const Broken&) { throw std::out_of_range("broken"); }
+};
+
+// A scheduler that runs scheduled work only when told to.
+class manual_scheduler {
+  std::deque<std::function<void()>>* queue_;
+
+  template <typename Receiver>
+  struct operation {
+    std::deque<std::function<void()>>* queue;
+    Receiver receiver;
+    void start() noexcept { queue->push_back([this] { receiver.set_value(); }); }
+  };
+
+ public:
+  struct sender {
+    using value_type = void;
+    std::deque<std::function<void()>>* queue;
+    template <typename Receiver>
+    operation<std::decay_t<Receiver>> connect(Receiver&& r) const {
+      return { queue, std::forward<Receiver>(r) };
+    }
+  };
+
+  explicit manual_scheduler(std::deque<std::function<void()>>& q)
+    : queue_(&q) {}
+  sender schedule() const { return { queue_ }; }
+};
+
+struct string_receiver {
+  std::string* out;
+  void set_value(std::string s) { *out = std::move(s); }
+  void set_error(std::exception_ptr) { *out = "error"; }
+  void set_stopped() { *out = "stopped"; }
+};
+
+} // namespace
+
+TEST(execution, schedule_send_is_lazy) {
+  Directory dir{};
+  auto m = holden::make_mediator(dir);
+
+  auto touch = m.schedule_send(Touch{});
+  ASSERT_EQ(0, dir.touches);
+  ex::sync_wait(touch);
+  ex::sync_wait(touch);
+  ASSERT_EQ(2, dir.touches);
+  ASSERT_EQ("user7", ex::sync_wait(m.schedule_send(Lookup{7})));
+}
+
+TEST(execution, then_composes) {
+  Directory dir{};
+  auto m = holden::make_mediator(dir);
+
+  auto length = ex::then(
+      ex::then(m.schedule_send(Lookup{42}),
+               [](std::string s) { return s.size(); }),
+      [](std::size_t n) { return int(n) * 2; });
+  ASSERT_EQ(12, ex::sync_wait(std::move(length)));
+
+  bool ran = false;
+  ex::sync_wait(ex::then(m.schedule_send(Touch{}), [&] { ran = true; }));
+  ASSERT_TRUE(ran);
+}
+
+TEST(execution, errors_propagate) {
+  Directory dir{};
+  auto m = holden::make_mediator(dir);
+
+  bool ran = false;
+  ASSERT_THROW(ex::sync_wait(ex::then(m.schedule_send(Broken{}),
+                                      [&](int) { ran = true; return 0; })),
+               std::out_of_range);
+  ASSERT_FALSE(ran);
+
+  ASSERT_THROW(ex::sync_wait(ex::then(m.schedule_send(Count{}), [](int) {
+                 throw std::logic_error("in then");
+               })),
+               std::logic_error);
+}
+
+TEST(execution, when_all_collects_values) {
+  Directory dir{};
+  auto m = holden::make_mediator(dir);
+
+  auto all = ex::when_all(m.schedule_send(Lookup{1}),
+                          m.schedule_send(Touch{}),
+                          m.schedule_send(Count{}));
+  std::tuple<std::string, int> values = ex::sync_wait(std::move(all));
+  ASSERT_EQ("user1", std::get<0>(values));
+  ASSERT_EQ(3, std::get<1>(values));
+  ASSERT_EQ(1, dir.touches);
+
+  ASSERT_THROW(ex::sync_wait(ex::when_all(m.schedule_send(Count{}),
+                                          m.schedule_send(Broken{}))),
+               std::out_of_range);
+}
+
+TEST(execution, starts_on_dispatcher_scheduler) {
+  Directory dir{};
+  auto m = holden::make_mediator(dir);
+  holden::dispatcher<decltype(m)> d(m);
+
+  auto on_worker = ex::starts_on(d.get_scheduler(),
+                                 m.schedule_send(Lookup{5}));
+  auto inline_send = ex::starts_on(ex::inline_scheduler{},
+                                   m.schedule_send(Count{}));
+  auto values = ex::sync_wait(ex::when_all(std::move(on_worker),
+                                           std::move(inline_send)));
+  ASSERT_EQ("user5", std::get<0>(values));
+  ASSERT_EQ(3, std::get<1>(values));
+  ASSERT_NE(std::this_thread::get_id(), dir.last_thread);
+  ASSERT_TRUE(d.get_scheduler() == d.get_scheduler());
+}
+
+TEST(execution, custom_scheduler) {
+  Directory dir{};
+  auto m = holden::make_mediator(dir);
+  std::deque<std::function<void()>> queue;
+  manual_scheduler sched(queue);
+
+  std::string seen;
+  auto op = ex::then(ex::starts_on(sched, m.schedule_send(Lookup{9})),
+                     [](std::string s) { return s + "!"; })
+      .connect(string_receiver{&seen});
+  op.start();
+  ASSERT_TRUE(seen.empty());
+  ASSERT_EQ(1u, queue.size());
+
+  queue.front()();
+  ASSERT_EQ("user9!", seen);
+}
@@ -0,0 +1,130 @@
+#include "../include/cpp_mediator/fiber.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+struct Price : holden::request<int> {
+  int sku;
+  explicit Price(int s) : sku(s) {}
+};
+
+struct Quote : holden::request<int> {
+  int sku, quantity;
+  Quote(int s, int q) : sku(s), quantity(q) {}
+};
+
+struct Fail : holden::request<void> {};
+
+class Shop
+  : holden::request_handler<Price>
+  , holden::request_handler<Quote>
+  , holden::request_handler<Fail> {
+ public:
+  std::function<int(int)> price_of;
+  std::vector<std::string> trace;
+
+  int handle(const Price& r) {
+    trace.push_back("price start " + std::to_string(r.sku));
+    holden::fiber_scheduler::current()->yield();
+    trace.push_back("price end " + std::to_string(r.sku));
+    return r.sku * 10;
+  }
+  // Blocks on a nested send; only the fiber waits.
+  int handle(const Quote& r) { return price_of(r.sku) * r.quantity; }
+  void handle(const Fail&) { throw std::logic_error("fail"); }
+};
+
+} // namespace
+
+TEST(fiber, waiting_parks_the_fiber_not_the_thread) {
+  Shop shop{};
+  auto m = holden::make_mediator(shop);
+  holden::fiber_scheduler fibers;
+
+  const auto thread = std::this_thread::get_id();
+  int a = 0, b = 0;
+  fibers.spawn([&] {
+    auto first = fibers.send_async(m, Price{1});
+    auto second = fibers.send_async(m, Price{2});
+    a = first.get();
+    b = second.get();
+    EXPECT_EQ(thread, std::this_thread::get_id());
+  });
+  fibers.run();
+
+  ASSERT_EQ(10, a);
+  ASSERT_EQ(20, b);
+  // Both handlers were in flight at once on the one thread.
+  ASSERT_EQ((std::vector<std::string>{
+      "price start 1", "price start 2", "price end 1", "price end 2"}),
+      shop.trace);
+}
+
+TEST(fiber, handlers_block_on_nested_sends) {
+  Shop shop{};
+  auto m = holden::make_mediator(shop);
+  holden::fiber_scheduler fibers;
+  shop.price_of = [&](int sku) { return fibers.send_async(m, Price{sku}).get(); };
+
+  // Called from outside any fiber, get() drives the scheduler itself.
+  ASSERT_EQ(150, fibers.send_async(m, Quote{3, 5}).get());
+}
+
+TEST(fiber, exceptions_reach_the_waiter) {
+  Shop shop{};
+  auto m = holden::make_mediator(shop);
+  holden::fiber_scheduler fibers;
+  auto f = fibers.send_async(m, Fail{});
+  ASSERT_THROW(f.get(), std::logic_error);
+
+  fibers.spawn([] { throw std::runtime_error("escaped"); });
+  ASSERT_THROW(fibers.run(), std::runtime_error);
+}
+
+TEST(fiber, recycles_finished_fibers) {
+  Shop shop{};
+  auto m = holden::make_mediator(shop);
+  holden::fiber_scheduler fibers;
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(i * 10, fibers.send_async(m, Price{i}).get());
+  ASSERT_EQ(1u, fibers.fiber_count());
+}
+
+TEST(fiber, get_reports_misuse_and_deadlock) {
+  Shop shop{};
+  auto m = holden::make_mediator(shop);
+  holden::fiber_scheduler fibers;
+
+  static_assert(!std::is_copy_constructible<holden::fiber_future<int>>::value,
+                "a future has one waiter, so it cannot be shared");
+  auto once = fibers.send_async(m, Price{1});
+  ASSERT_EQ(10, once.get());
+  ASSERT_FALSE(once.valid());
+  ASSERT_THROW(once.get(), std::future_error);
+
+  // A chain of handlers ending in one that waits on a response nothing
+  // will ever provide.
+  holden::fiber_future<int> never(fibers,
+      std::make_shared<holden::detail::fiber_future_state<int>>());
+  holden::fiber_future<int>* waits_on[3] = {};
+  shop.price_of = [&](int sku) { return waits_on[sku]->get(); };
+  auto first = fibers.send_async(m, Quote{1, 1});
+  auto second = fibers.send_async(m, Quote{2, 1});
+  waits_on[1] = &second;
+  waits_on[2] = &never;
+  try {
+    first.get();
+    FAIL() << "expected a broken promise";
+  } catch (const std::future_error& e) {
+    ASSERT_EQ(std::future_errc::broken_promise, e.code());
+  }
+}
@@ -0,0 +1,65 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/mediator_ref.hpp"
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+struct Get : holden::request<int> {};
+
+struct Put : holden::request<void> {
+  int value;
+  explicit Put(int v) : value(v) {}
+};
+
+struct Describe : holden::request<std::string> {};
+
+class Store
+  : holden::request_handler<Get>
+  , holden::request_handler<Put> {
+ public:
+  int value = 0;
+  int handle(const Get&) { return value; }
+  void handle(const Put& p) { value = p.value; }
+};
+
+class Describer : holden::request_handler<Describe> {
+ public:
+  std::string handle(const Describe&) { return "store"; }
+};
+
+// Not a template: depends only on the requests it sends.
+int bump(holden::mediator_ref<Get, Put> m) {
+  m.send(Put{m.send(Get{}) + 1});
+  return m.send(Get{});
+}
+
+} // namespace
+
+TEST(mediator_ref, sends_through_any_mediator_with_the_handlers) {
+  Store store{};
+  Describer describer{};
+  auto just_store = holden::make_mediator(store);
+  auto both = holden::make_mediator(describer, store);
+
+  ASSERT_EQ(1, bump(just_store));
+  ASSERT_EQ(2, bump(both));
+  ASSERT_EQ(2, store.value);
+
+  holden::mediator_ref<Describe, Get> ref(both);
+  ASSERT_EQ("store", ref.send(Describe{}));
+  ASSERT_EQ(2, ref.send(Get{}));
+}
+
+TEST(mediator_ref, is_two_pointers_and_copyable) {
+  static_assert(sizeof(holden::mediator_ref<Get, Put, Describe>)
+                  == 2 * sizeof(void*),
+                "the handler list is erased into a shared static table");
+  Store store{};
+  auto m = holden::make_mediator(store);
+  holden::mediator_ref<Get, Put> a(m);
+  auto b = a;
+  b.send(Put{5});
+  ASSERT_EQ(5, a.send(Get{}));
+}
@@ -164,3 +164,25 @@ TEST(cpp_mediator, request_mutations_preserved) {
   ASSERT_EQ(102, *request_d.x);
   ASSERT_EQ(102, number);
 }
+
+TEST(cpp_mediator, merge_mediators_flattens_handlers) {
+  AHandler1 a{};
+  BHandler b{};
+  ReqHandlera ha{};
+  auto first = holden::make_mediator(a);
+  auto second = holden::make_mediator(b, ha);
+  auto empty = holden::make_mediator();
+
+  auto merged = holden::merge_mediators(first, empty, second);
+  static_assert(std::is_same<decltype(merged),
+                  holden::mediator<AHandler1&, BHandler&, ReqHandlera&>>::value,
+                "merging flattens into one mediator, as if hand-written");
+  ASSERT_EQ(1, merged.send(GetA{}));
+  ASSERT_EQ(3, merged.send(GetB{}));
+  ASSERT_EQ(127, merged.send(Reqa{}));
+  ASSERT_EQ(&a, &std::get<0>(merged.handlers()));
+
+  // Does not compile: AHandler1 is registered in both.
+  //
+  // holden::merge_mediators(first, holden::make_mediator(a, b));
+}
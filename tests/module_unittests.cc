@@ -0,0 +1,38 @@
+// Built only with -DMODULES=ON (module_tests).
+
+#include <gtest/gtest.h>
+import cpp_mediator;
+
+namespace {
+
+struct Get : holden::request<int> {};
+
+class Counter : holden::request_handler<Get> {
+ public:
+  int calls = 0;
+  int handle(const Get&) { return ++calls; }
+};
+
+// Found through the C++20 concept check.
+struct Plain {
+  int handle(const Get&) { return 7; }
+};
+
+} // namespace
+
+TEST(module, sends_through_imported_mediator) {
+  Counter counter;
+  auto m = holden::make_mediator(counter);
+  ASSERT_EQ(1, m.send(Get{}));
+  ASSERT_EQ(2, m.send(Get{}));
+
+  Plain plain;
+  auto m2 = holden::make_mediator(plain);
+  ASSERT_EQ(7, m2.send(Get{}));
+}
+
+TEST(module, results_are_exported) {
+  holden::result<int> r(3);
+  ASSERT_TRUE(r.has_value());
+  ASSERT_EQ(3, r.value());
+}
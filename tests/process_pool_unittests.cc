@@ -0,0 +1,101 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/process_pool.hpp"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+struct Crunch {
+  using response_type = pid_t;
+  int milliseconds;
+};
+
+struct Die {
+  using response_type = void;
+};
+
+// Blocks the worker handling it until a byte arrives on `fd`, a pipe
+// created before the pool forked.
+struct Hold {
+  using response_type = pid_t;
+  int fd;
+};
+
+// Not thread-safe: keeps its scratch state in a global.
+int g_scratch = 0;
+
+class Cruncher
+  : holden::request_handler<Crunch>
+  , holden::request_handler<Die>
+  , holden::request_handler<Hold> {
+ public:
+  pid_t handle(const Crunch& r) {
+    ++g_scratch;
+    std::this_thread::sleep_for(std::chrono::milliseconds(r.milliseconds));
+    return ::getpid();
+  }
+  void handle(const Die&) { std::abort(); }
+  pid_t handle(const Hold& r) {
+    char byte;
+    while (::read(r.fd, &byte, 1) < 0) {}
+    return ::getpid();
+  }
+};
+
+using pool_t = holden::process_pool<Cruncher, Crunch, Die, Hold>;
+
+} // namespace
+
+TEST(process_pool, spreads_sequential_requests) {
+  Cruncher cruncher{};
+  pool_t pool(cruncher, 3);
+  auto m = holden::make_mediator(pool);
+
+  std::set<pid_t> pids;
+  for (int i = 0; i < 6; ++i) pids.insert(m.send(Crunch{0}));
+  ASSERT_EQ(3u, pids.size());
+  ASSERT_EQ(0u, pids.count(::getpid()));
+}
+
+TEST(process_pool, balances_by_outstanding_requests) {
+  int gate[2];
+  ASSERT_EQ(0, ::pipe(gate));
+  Cruncher cruncher{};
+  pool_t pool(cruncher, 2);
+
+  pid_t held_pid = 0;
+  std::thread held([&] { held_pid = pool.handle(Hold{gate[0]}); });
+  while (pool.outstanding(0) + pool.outstanding(1) == 0)
+    std::this_thread::yield();
+  const std::size_t busy = pool.outstanding(0) ? 0 : 1;
+  const pid_t idle_pid = pool.worker_at(1 - busy).pid();
+
+  // With one worker held, every other request goes to the idle one.
+  for (int i = 0; i < 3; ++i) ASSERT_EQ(idle_pid, pool.handle(Crunch{0}));
+
+  ASSERT_EQ(1, ::write(gate[1], "x", 1));
+  held.join();
+  ASSERT_EQ(pool.worker_at(busy).pid(), held_pid);
+  ASSERT_EQ(0u, pool.outstanding(0));
+  ASSERT_EQ(0u, pool.outstanding(1));
+  ::close(gate[0]);
+  ::close(gate[1]);
+}
+
+TEST(process_pool, skips_dead_workers) {
+  Cruncher cruncher{};
+  pool_t pool(cruncher, 2);
+
+  ASSERT_THROW(pool.handle(Die{}), holden::remote_handler_error);
+  for (int i = 0; i < 4; ++i) ASSERT_NE(0, pool.handle(Crunch{0}));
+
+  ASSERT_THROW(pool.handle(Die{}), holden::remote_handler_error);
+  ASSERT_THROW(pool.handle(Crunch{0}), holden::remote_handler_error);
+}
@@ -0,0 +1,130 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/process_proxy.hpp"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+
+// Requests crossing a process boundary must be trivially copyable, so they
+// declare `response_type` directly rather than deriving `request<>`.
+struct Scale {
+  using response_type = double;
+  double value;
+  int factor;
+};
+
+struct WhoAmI {
+  using response_type = pid_t;
+};
+
+struct Count {
+  using response_type = void;
+};
+
+struct Crash {
+  using response_type = int;
+  bool by_throwing;
+};
+
+struct Local : holden::request<int> {};
+
+// Its handler returns a narrower type than the declared response.
+struct Widen {
+  using response_type = long;
+  long payload;
+};
+
+// Stands in for legacy code: keeps its state in a global.
+int g_counted = 0;
+
+class Legacy
+  : holden::request_handler<Scale>
+  , holden::request_handler<WhoAmI>
+  , holden::request_handler<Count>
+  , holden::request_handler<Crash> {
+ public:
+  double handle(const Scale& r) { return r.value * r.factor + g_counted; }
+  pid_t handle(const WhoAmI&) { return ::getpid(); }
+  void handle(const Count&) { ++g_counted; }
+  int handle(const Crash& r) {
+    if (r.by_throwing) throw std::runtime_error("boom");
+    std::abort();
+  }
+};
+
+class LocalHandler : holden::request_handler<Local> {
+ public:
+  int handle(const Local&) { return 7; }
+};
+
+class Narrow : holden::request_handler<Widen> {
+ public:
+  int handle(const Widen&) { return 7; }
+};
+
+using legacy_proxy = holden::process_proxy<Legacy, Scale, WhoAmI, Count, Crash>;
+
+} // namespace
+
+TEST(process_proxy, handles_requests_in_child_process) {
+  Legacy legacy{};
+  LocalHandler local{};
+  legacy_proxy proxy(legacy);
+  auto m = holden::make_mediator(proxy, local);
+
+  ASSERT_NE(::getpid(), m.send(WhoAmI{}));
+  ASSERT_EQ(proxy.pid(), m.send(WhoAmI{}));
+  ASSERT_EQ(7, m.send(Local{}));
+  ASSERT_DOUBLE_EQ(5.0, m.send(Scale{2.5, 2}));
+
+  // The child's globals are its own.
+  m.send(Count{});
+  m.send(Count{});
+  ASSERT_DOUBLE_EQ(7.0, m.send(Scale{2.5, 2}));
+  ASSERT_EQ(0, g_counted);
+}
+
+TEST(process_proxy, concurrent_callers) {
+  Legacy legacy{};
+  legacy_proxy proxy(legacy);
+  auto m = holden::make_mediator(proxy);
+
+  std::vector<std::thread> callers;
+  std::atomic<int> mismatches{0};
+  for (int t = 0; t < 4; ++t) {
+    callers.emplace_back([&, t] {
+      for (int i = 0; i < 200; ++i) {
+        if (m.send(Scale{double(i), t}) != double(i * t)) ++mismatches;
+      }
+    });
+  }
+  for (auto& c : callers) c.join();
+  ASSERT_EQ(0, mismatches.load());
+}
+
+TEST(process_proxy, response_has_the_declared_type) {
+  Narrow narrow{};
+  holden::process_proxy<Narrow, Widen> proxy(narrow);
+  for (int i = 0; i < 100; ++i)
+    ASSERT_EQ(7L, proxy.handle(Widen{-1L}));
+}
+
+TEST(process_proxy, handler_exception_is_reported) {
+  Legacy legacy{};
+  legacy_proxy proxy(legacy);
+  ASSERT_THROW(proxy.handle(Crash{true}), holden::remote_handler_error);
+  ASSERT_DOUBLE_EQ(3.0, proxy.handle(Scale{1.5, 2}));
+}
+
+TEST(process_proxy, crash_is_isolated) {
+  Legacy legacy{};
+  legacy_proxy proxy(legacy);
+  ASSERT_THROW(proxy.handle(Crash{false}), holden::remote_handler_error);
+  ASSERT_THROW(proxy.handle(WhoAmI{}), holden::remote_handler_error);
+}
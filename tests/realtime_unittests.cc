@@ -0,0 +1,378 @@
+// Built as its own executable: it replaces the allocation functions, the
+// pthread locking and waiting functions, and the libc wrappers of the
+// syscalls a dispatcher or the standard library could make on a send path
+// (futex through syscall(), sleeping, yielding, I/O, semaphores) for the
+// whole process, so that a thread can declare itself real-time and have
+// any call to them counted as a violation. Calls libc makes internally,
+// between its own functions, are not seen.
+
+#include "../include/cpp_mediator/detail/futex.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/realtime.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <dlfcn.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" void* __libc_malloc(std::size_t);
+extern "C" void* __libc_calloc(std::size_t, std::size_t);
+extern "C" void* __libc_realloc(void*, std::size_t);
+
+namespace {
+
+thread_local bool realtime_thread = false;
+std::atomic<int> allocations{0};
+std::atomic<int> locks{0};
+std::atomic<int> syscalls{0};
+
+// Resolved before main, while nothing is marked real-time.
+template <typename F>
+F next(const char* name) {
+  return reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+}
+
+// The condition variable functions are versioned; plain dlsym finds the
+// compatibility ones.
+template <typename F>
+F next_cond(const char* name) {
+#if defined(__x86_64__)
+  return reinterpret_cast<F>(dlvsym(RTLD_NEXT, name, "GLIBC_2.3.2"));
+#else
+  return next<F>(name);
+#endif
+}
+
+const auto real_mutex_lock =
+    next<int (*)(pthread_mutex_t*)>("pthread_mutex_lock");
+const auto real_mutex_trylock =
+    next<int (*)(pthread_mutex_t*)>("pthread_mutex_trylock");
+const auto real_mutex_timedlock =
+    next<int (*)(pthread_mutex_t*, const timespec*)>("pthread_mutex_timedlock");
+const auto real_rwlock_rdlock =
+    next<int (*)(pthread_rwlock_t*)>("pthread_rwlock_rdlock");
+const auto real_rwlock_wrlock =
+    next<int (*)(pthread_rwlock_t*)>("pthread_rwlock_wrlock");
+const auto real_spin_lock =
+    next<int (*)(pthread_spinlock_t*)>("pthread_spin_lock");
+
+const auto real_cond_wait =
+    next_cond<int (*)(pthread_cond_t*, pthread_mutex_t*)>("pthread_cond_wait");
+const auto real_cond_timedwait =
+    next_cond<int (*)(pthread_cond_t*, pthread_mutex_t*, const timespec*)>(
+        "pthread_cond_timedwait");
+const auto real_cond_signal =
+    next_cond<int (*)(pthread_cond_t*)>("pthread_cond_signal");
+const auto real_cond_broadcast =
+    next_cond<int (*)(pthread_cond_t*)>("pthread_cond_broadcast");
+
+const auto real_syscall = next<long (*)(long, ...)>("syscall");
+const auto real_sched_yield = next<int (*)()>("sched_yield");
+const auto real_nanosleep =
+    next<int (*)(const timespec*, timespec*)>("nanosleep");
+const auto real_clock_nanosleep =
+    next<int (*)(clockid_t, int, const timespec*, timespec*)>(
+        "clock_nanosleep");
+const auto real_usleep = next<int (*)(useconds_t)>("usleep");
+const auto real_read = next<ssize_t (*)(int, void*, size_t)>("read");
+const auto real_write = next<ssize_t (*)(int, const void*, size_t)>("write");
+const auto real_send =
+    next<ssize_t (*)(int, const void*, size_t, int)>("send");
+const auto real_recv = next<ssize_t (*)(int, void*, size_t, int)>("recv");
+const auto real_poll = next<int (*)(pollfd*, nfds_t, int)>("poll");
+const auto real_epoll_wait =
+    next<int (*)(int, epoll_event*, int, int)>("epoll_wait");
+const auto real_sem_wait = next<int (*)(sem_t*)>("sem_wait");
+const auto real_sem_timedwait =
+    next<int (*)(sem_t*, const timespec*)>("sem_timedwait");
+const auto real_sem_post = next<int (*)(sem_t*)>("sem_post");
+
+void reset_counts() {
+  allocations = 0;
+  locks = 0;
+  syscalls = 0;
+}
+
+// Marks the current thread real-time for its lifetime.
+struct realtime_section {
+  realtime_section() { realtime_thread = true; }
+  ~realtime_section() { realtime_thread = false; }
+};
+
+} // namespace
+
+extern "C" {
+
+void* malloc(std::size_t size) {
+  if (realtime_thread) ++allocations;
+  return __libc_malloc(size);
+}
+
+void* calloc(std::size_t n, std::size_t size) {
+  if (realtime_thread) ++allocations;
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, std::size_t size) {
+  if (realtime_thread) ++allocations;
+  return __libc_realloc(p, size);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* m) {
+  if (realtime_thread) ++locks;
+  return real_mutex_lock(m);
+}
+
+int pthread_mutex_trylock(pthread_mutex_t* m) {
+  if (realtime_thread) ++locks;
+  return real_mutex_trylock(m);
+}
+
+int pthread_mutex_timedlock(pthread_mutex_t* m, const timespec* t) {
+  if (realtime_thread) ++locks;
+  return real_mutex_timedlock(m, t);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* l) {
+  if (realtime_thread) ++locks;
+  return real_rwlock_rdlock(l);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* l) {
+  if (realtime_thread) ++locks;
+  return real_rwlock_wrlock(l);
+}
+
+int pthread_spin_lock(pthread_spinlock_t* l) {
+  if (realtime_thread) ++locks;
+  return real_spin_lock(l);
+}
+
+int pthread_cond_wait(pthread_cond_t* c, pthread_mutex_t* m) {
+  if (realtime_thread) ++syscalls;
+  return real_cond_wait(c, m);
+}
+
+int pthread_cond_timedwait(pthread_cond_t* c, pthread_mutex_t* m,
+                           const timespec* t) {
+  if (realtime_thread) ++syscalls;
+  return real_cond_timedwait(c, m, t);
+}
+
+int pthread_cond_signal(pthread_cond_t* c) noexcept {
+  if (realtime_thread) ++syscalls;
+  return real_cond_signal(c);
+}
+
+int pthread_cond_broadcast(pthread_cond_t* c) noexcept {
+  if (realtime_thread) ++syscalls;
+  return real_cond_broadcast(c);
+}
+
+long syscall(long number, ...) noexcept {
+  if (realtime_thread) ++syscalls;
+  va_list args;
+  va_start(args, number);
+  long a[6];
+  for (auto& arg : a) arg = va_arg(args, long);
+  va_end(args);
+  return real_syscall(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+int sched_yield() noexcept {
+  if (realtime_thread) ++syscalls;
+  return real_sched_yield();
+}
+
+int nanosleep(const timespec* t, timespec* left) {
+  if (realtime_thread) ++syscalls;
+  return real_nanosleep(t, left);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const timespec* t,
+                    timespec* left) {
+  if (realtime_thread) ++syscalls;
+  return real_clock_nanosleep(clock, flags, t, left);
+}
+
+int usleep(useconds_t us) {
+  if (realtime_thread) ++syscalls;
+  return real_usleep(us);
+}
+
+ssize_t read(int fd, void* buf, size_t n) {
+  if (realtime_thread) ++syscalls;
+  return real_read(fd, buf, n);
+}
+
+ssize_t write(int fd, const void* buf, size_t n) {
+  if (realtime_thread) ++syscalls;
+  return real_write(fd, buf, n);
+}
+
+ssize_t send(int fd, const void* buf, size_t n, int flags) {
+  if (realtime_thread) ++syscalls;
+  return real_send(fd, buf, n, flags);
+}
+
+ssize_t recv(int fd, void* buf, size_t n, int flags) {
+  if (realtime_thread) ++syscalls;
+  return real_recv(fd, buf, n, flags);
+}
+
+int poll(pollfd* fds, nfds_t n, int timeout) {
+  if (realtime_thread) ++syscalls;
+  return real_poll(fds, n, timeout);
+}
+
+int epoll_wait(int fd, epoll_event* events, int n, int timeout) {
+  if (realtime_thread) ++syscalls;
+  return real_epoll_wait(fd, events, n, timeout);
+}
+
+int sem_wait(sem_t* s) {
+  if (realtime_thread) ++syscalls;
+  return real_sem_wait(s);
+}
+
+int sem_timedwait(sem_t* s, const timespec* t) {
+  if (realtime_thread) ++syscalls;
+  return real_sem_timedwait(s, t);
+}
+
+int sem_post(sem_t* s) noexcept {
+  if (realtime_thread) ++syscalls;
+  return real_sem_post(s);
+}
+
+} // extern "C"
+
+namespace {
+
+struct Gain : holden::request<float> {
+  float sample;
+  explicit Gain(float s) : sample(s) {}
+};
+
+// Marks the worker real-time, or not, from inside a send.
+struct Enter : holden::request<void> {};
+struct Leave : holden::request<void> {};
+
+struct Amp
+  : holden::request_handler<Gain>
+  , holden::request_handler<Enter>
+  , holden::request_handler<Leave> {
+  std::atomic<bool>* hold = nullptr;
+
+  float handle(const Gain& g) {
+    while (hold && hold->load(std::memory_order_acquire)) {}
+    return g.sample * 2;
+  }
+  void handle(const Enter&) { realtime_thread = true; }
+  void handle(const Leave&) { realtime_thread = false; }
+};
+
+// Sends `r` from a non-real-time thread and waits for it to be handled.
+template <typename Dispatcher, typename TRequest>
+void send_and_wait(Dispatcher& d, TRequest r) {
+  std::atomic<bool> done{false};
+  while (!d.try_send_then(r, [&done](holden::result<void>) { done = true; })) {}
+  while (!done.load()) {}
+}
+
+} // namespace
+
+TEST(realtime, harness_catches_violations) {
+  reset_counts();
+  {
+    realtime_section rt;
+    std::unique_ptr<int> leak(new int(1));
+    std::mutex m;
+    m.lock();
+    m.unlock();
+    std::atomic<std::uint32_t> word{0};
+    holden::detail::futex_wake(word, 1);
+    std::this_thread::yield();
+    std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+    std::condition_variable cv;
+    cv.notify_one();
+    ASSERT_EQ(-1, ::write(-1, "", 0));
+  }
+  ASSERT_EQ(1, allocations.load());
+  ASSERT_EQ(1, locks.load());
+  ASSERT_EQ(5, syscalls.load());
+}
+
+TEST(realtime, plain_send_is_realtime_safe) {
+  Amp amp{};
+  auto m = holden::make_mediator(amp);
+  reset_counts();
+  float out = 0;
+  {
+    realtime_section rt;
+    for (int i = 0; i < 1000; ++i) out += m.send(Gain{1.0f});
+  }
+  ASSERT_EQ(2000.0f, out);
+  ASSERT_EQ(0, allocations + locks + syscalls);
+}
+
+TEST(realtime, queued_sends_are_realtime_safe_on_both_threads) {
+  Amp amp{};
+  auto m = holden::make_mediator(amp);
+  holden::realtime_dispatcher<decltype(m)> d(m);
+  send_and_wait(d, Enter{});
+
+  reset_counts();
+  std::atomic<int> completed{0};
+  std::atomic<int> rejected{0};
+  {
+    realtime_section rt;
+    for (int i = 0; i < 10000; ++i) {
+      const bool sent = d.try_send_then(Gain{float(i)},
+          [&completed](holden::result<float> r) {
+            if (r) completed.fetch_add(1, std::memory_order_relaxed);
+          });
+      if (!sent) ++rejected;
+    }
+    while (completed.load() + rejected.load() < 10000) {}
+  }
+  const int violations = allocations + locks + syscalls;
+  send_and_wait(d, Leave{});
+
+  ASSERT_EQ(0, violations);
+  ASSERT_EQ(10000, completed + rejected);
+}
+
+TEST(realtime, full_queue_is_reported_not_waited_on) {
+  std::atomic<bool> hold{true};
+  Amp amp{};
+  amp.hold = &hold;
+  auto m = holden::make_mediator(amp);
+  holden::realtime_dispatcher<decltype(m), 4> d(m);
+
+  std::atomic<int> completed{0};
+  auto then = [&completed](holden::result<float>) { ++completed; };
+  int accepted = 0;
+  while (d.try_send_then(Gain{1.0f}, then)) ++accepted;
+  // One send is being handled, the rest fill the queue.
+  ASSERT_LE(4, accepted);
+  ASSERT_GE(5, accepted);
+
+  hold = false;
+  while (completed.load() < accepted) {}
+}
@@ -0,0 +1,111 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/replicas.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Count : holden::request<int> {};
+
+struct Slow : holden::request<void> {
+  std::promise<void>* started;
+  std::shared_future<void> release;
+  Slow(std::promise<void>* s, std::shared_future<void> r)
+    : started(s), release(std::move(r)) {}
+};
+
+class Counter
+  : holden::request_handler<Count>
+  , holden::request_handler<Slow> {
+ public:
+  int base = 0;
+  int count = 0;
+  std::set<std::thread::id> threads;
+
+  Counter() = default;
+  explicit Counter(int b) : base(b) {}
+
+  int handle(const Count&) {
+    threads.insert(std::this_thread::get_id());
+    return base + ++count;
+  }
+  void handle(const Slow& s) {
+    ++count;
+    s.started->set_value();
+    s.release.wait();
+  }
+};
+
+} // namespace
+
+TEST(replicas, round_robin_spreads_sends) {
+  holden::replicas<Counter, 3> counters(100);
+  auto m = holden::make_mediator(counters);
+
+  for (int i = 0; i < 9; ++i) m.send(Count{});
+  counters.for_each([](Counter& c) {
+    ASSERT_EQ(100, c.base);
+    ASSERT_EQ(3, c.count);
+  });
+  ASSERT_EQ(104, m.send(Count{}));
+}
+
+TEST(replicas, thread_affinity_pins_threads_to_replicas) {
+  holden::replicas<Counter, 4, holden::thread_affinity> counters;
+  auto m = holden::make_mediator(counters);
+
+  // Neither exited threads nor other replica sets use up slots.
+  std::thread([&] { m.send(Count{}); }).join();
+  counters[0].count = 0;
+  counters[0].threads.clear();
+
+  holden::replicas<Counter, 4, holden::thread_affinity> others;
+  auto other_m = holden::make_mediator(others);
+
+  std::atomic<int> started{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      m.send(Count{});
+      ++started;
+      while (started < 4) std::this_thread::yield();
+      for (int i = 1; i < 1000; ++i) m.send(Count{});
+    });
+    while (started < t + 1) std::this_thread::yield();
+    if (t == 0) std::thread([&] { other_m.send(Count{}); }).join();
+  }
+  for (auto& t : threads) t.join();
+
+  int total = 0;
+  counters.for_each([&](Counter& c) {
+    ASSERT_EQ(1u, c.threads.size());
+    ASSERT_EQ(1000, c.count);
+    total += c.count;
+  });
+  ASSERT_EQ(4000, total);
+}
+
+TEST(replicas, least_loaded_skips_busy_replicas) {
+  holden::replicas<Counter, 2, holden::least_loaded> counters;
+  auto m = holden::make_mediator(counters);
+
+  std::promise<void> started, release;
+  auto slow = std::async(std::launch::async, [&] {
+    m.send(Slow{&started, release.get_future().share()});
+  });
+  started.get_future().wait();
+  ASSERT_EQ(1u, counters.selector().in_flight(0));
+
+  for (int i = 0; i < 5; ++i) m.send(Count{});
+  ASSERT_EQ(1, counters[0].count);
+  ASSERT_EQ(5, counters[1].count);
+
+  release.set_value();
+  slow.get();
+  ASSERT_EQ(0u, counters.selector().in_flight(0));
+}
@@ -0,0 +1,103 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/request_family.hpp"
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+
+struct OrderEvent;
+struct OrderPlaced;
+struct BulkOrderPlaced;
+struct OrderCancelled;
+using order_events = holden::request_family<
+  OrderEvent, OrderPlaced, BulkOrderPlaced, OrderCancelled>;
+
+struct OrderEvent : holden::family_root<order_events, std::string> {
+  int order;
+  explicit OrderEvent(int o) : order(o) {}
+};
+
+struct OrderPlaced : holden::derived_request<OrderPlaced, OrderEvent> {
+  using derived_request::derived_request;
+};
+
+struct BulkOrderPlaced
+  : holden::derived_request<BulkOrderPlaced, OrderPlaced> {
+  int quantity;
+  BulkOrderPlaced(int o, int q) : derived_request(o), quantity(q) {}
+};
+
+struct OrderCancelled : holden::derived_request<OrderCancelled, OrderEvent> {
+  using derived_request::derived_request;
+};
+
+class Audit : holden::request_handler<OrderEvent> {
+ public:
+  std::string handle(const OrderEvent& e) {
+    return "audit " + std::to_string(e.order);
+  }
+};
+
+class Fulfilment : holden::request_handler<OrderPlaced> {
+ public:
+  std::string handle(const OrderPlaced& e) {
+    return "ship " + std::to_string(e.order);
+  }
+};
+
+} // namespace
+
+TEST(request_family, most_specific_handler_wins_at_compile_time) {
+  Audit audit{};
+  Fulfilment fulfilment{};
+  auto m = holden::make_mediator(audit, fulfilment);
+
+  ASSERT_EQ("audit 1", m.send(OrderEvent{1}));
+  ASSERT_EQ("ship 2", m.send(OrderPlaced{2}));
+  ASSERT_EQ("ship 3", m.send(BulkOrderPlaced{3, 10}));  // via OrderPlaced
+  ASSERT_EQ("audit 4", m.send(OrderCancelled{4}));      // via OrderEvent
+}
+
+TEST(request_family, send_dynamic_dispatches_on_the_dynamic_type) {
+  Audit audit{};
+  Fulfilment fulfilment{};
+  auto m = holden::make_mediator(audit, fulfilment);
+
+  const BulkOrderPlaced bulk(5, 10);
+  const OrderCancelled cancelled(6);
+  const OrderEvent& as_event = bulk;
+  const OrderPlaced& as_placed = bulk;
+  ASSERT_EQ(2u, as_event.family_index());
+
+  ASSERT_EQ("audit 5", m.send(as_event));  // static type only
+  ASSERT_EQ("ship 5", holden::send_dynamic(m, as_event));
+  ASSERT_EQ("ship 5", holden::send_dynamic(m, as_placed));
+  ASSERT_EQ("audit 6",
+            holden::send_dynamic(m, static_cast<const OrderEvent&>(cancelled)));
+}
+
+TEST(request_family, copies_are_of_their_own_type) {
+  Audit audit{};
+  Fulfilment fulfilment{};
+  auto m = holden::make_mediator(audit, fulfilment);
+
+  const BulkOrderPlaced bulk(7, 10);
+  OrderEvent sliced = bulk;
+  OrderPlaced sliced_placed = bulk;
+  BulkOrderPlaced copy = bulk;
+  ASSERT_EQ(0u, sliced.family_index());
+  ASSERT_EQ(1u, sliced_placed.family_index());
+  ASSERT_EQ(2u, copy.family_index());
+  ASSERT_EQ("audit 7", holden::send_dynamic(m, sliced));
+  ASSERT_EQ("ship 7", holden::send_dynamic(m, sliced_placed));
+
+  OrderEvent assigned{8};
+  assigned = bulk;
+  ASSERT_EQ(0u, assigned.family_index());
+  ASSERT_EQ("audit 7", holden::send_dynamic(m, assigned));
+
+  BulkOrderPlaced moved_from(9, 10);
+  OrderEvent moved = std::move(moved_from);
+  ASSERT_EQ(0u, moved.family_index());
+}
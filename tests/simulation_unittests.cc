@@ -0,0 +1,126 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/simulation.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+struct Work : holden::request<int> {
+  int id;
+  explicit Work(int i) : id(i) {}
+};
+
+struct Fail : holden::request<void> {};
+
+class Worker
+  : holden::request_handler<Work>
+  , holden::request_handler<Fail> {
+ public:
+  holden::simulation<holden::mediator<Worker&>>* sim = nullptr;
+  std::vector<int> order;
+
+  int handle(const Work& w) {
+    order.push_back(w.id);
+    sim->advance(1ms);
+    return w.id * 10;
+  }
+  void handle(const Fail&) { throw std::runtime_error("fail"); }
+};
+
+std::vector<int> run_shuffled(std::uint64_t seed) {
+  Worker w{};
+  auto m = holden::make_mediator(w);
+  holden::simulation<decltype(m)> sim(m, seed);
+  w.sim = &sim;
+  for (int i = 0; i < 32; ++i) sim.send_then(Work{i}, [](holden::result<int>) {});
+  sim.run();
+  return w.order;
+}
+
+} // namespace
+
+TEST(simulation, runs_fifo_on_a_virtual_clock) {
+  Worker w{};
+  auto m = holden::make_mediator(w);
+  holden::simulation<decltype(m)> sim(m);
+  w.sim = &sim;
+
+  int total = 0;
+  for (int i = 0; i < 4; ++i)
+    sim.send_then(Work{i}, [&](holden::result<int> r) { total += r.value(); });
+  auto f = sim.send_async(Work{4});
+  ASSERT_EQ(5u, sim.pending());
+  ASSERT_TRUE(w.order.empty());
+
+  sim.run();
+  ASSERT_EQ((std::vector<int>{0, 1, 2, 3, 4}), w.order);
+  ASSERT_EQ(60, total);
+  ASSERT_EQ(40, f.get());
+  ASSERT_EQ(5ms, sim.now());
+
+  const auto& stats = sim.stats();
+  ASSERT_EQ(5u, stats.tasks_run);
+  ASSERT_EQ(5u, stats.max_ready);
+  ASSERT_EQ(4ms, stats.max_queue_delay);
+  ASSERT_EQ(10ms, stats.total_queue_delay);
+}
+
+TEST(simulation, timers_jump_the_clock) {
+  Worker w{};
+  auto m = holden::make_mediator(w);
+  holden::simulation<decltype(m)> sim(m);
+  w.sim = &sim;
+
+  std::vector<std::chrono::nanoseconds> fired;
+  sim.send_after(30ms, Work{3}, [&](holden::result<int>) {
+    fired.push_back(sim.now());
+  });
+  sim.call_after(10ms, [&] { fired.push_back(sim.now()); });
+  sim.call_after(10ms, [&] { fired.push_back(sim.now()); });
+
+  sim.run_until(20ms);
+  ASSERT_EQ((std::vector<std::chrono::nanoseconds>{10ms, 10ms}), fired);
+  ASSERT_EQ(20ms, sim.now());
+  ASSERT_EQ(1u, sim.pending());
+
+  sim.run();
+  ASSERT_EQ(31ms, fired.back());  // handler cost included
+  ASSERT_EQ(3u, sim.stats().timers_fired);
+}
+
+TEST(simulation, seeded_order_replays_exactly) {
+  const auto first = run_shuffled(42);
+  ASSERT_EQ(first, run_shuffled(42));
+  ASSERT_NE(first, run_shuffled(7));
+
+  auto sorted = first;
+  std::sort(sorted.begin(), sorted.end());
+  for (int i = 0; i < 32; ++i) ASSERT_EQ(i, sorted[i]);
+}
+
+TEST(simulation, nested_sends_are_queued_and_traced) {
+  Worker w{};
+  auto m = holden::make_mediator(w);
+  holden::simulation<decltype(m)> sim(m);
+  w.sim = &sim;
+  sim.set_tracing(true);
+
+  bool failed = false;
+  sim.send_then(Work{1}, [&](holden::result<int>) {
+    ASSERT_TRUE(sim.on_worker());
+    sim.send_then(Fail{}, [&](holden::result<void> r) { failed = !r; });
+    sim.send_then(Work{2}, [](holden::result<int>) {});
+  });
+  sim.execute([&] { ASSERT_EQ(1u, w.order.size()); });
+  sim.run();
+
+  ASSERT_TRUE(failed);
+  ASSERT_EQ((std::vector<std::uint64_t>{0, 1, 2, 3}), sim.trace());
+  ASSERT_FALSE(sim.on_worker());
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# Reports the code size of a binary, and how much of it each mediator's
+# instantiations account for: every symbol whose demangled name mentions a
+# `holden::mediator<...>` is charged to the first one it mentions.
+#
+# usage: size_report.sh <binary>
+
+set -e
+binary="$1"
+size "$binary"
+echo
+nm -C --size-sort --radix=d "$binary" | awk '
+  {
+    line = $0
+    start = index(line, "holden::mediator<")
+    if (start == 0) next
+    rest = substr(line, start)
+    depth = 0
+    key = ""
+    for (i = 1; i <= length(rest); i++) {
+      ch = substr(rest, i, 1)
+      key = key ch
+      if (ch == "<") depth++
+      else if (ch == ">") { depth--; if (depth == 0) break }
+    }
+    bytes[key] += $1
+    count[key]++
+  }
+  END {
+    for (k in bytes) printf "%8d bytes  %4d symbols  %s\n", bytes[k], count[k], k
+  }' | sort -rn
@@ -0,0 +1,143 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/socket_bridge.hpp"
+#include <gtest/gtest.h>
+
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+struct Multiply {
+  using response_type = long;
+  long a, b;
+};
+
+struct Log {
+  using response_type = void;
+  int line;
+};
+
+struct Reject {
+  using response_type = int;
+};
+
+class Remote
+  : holden::request_handler<Multiply>
+  , holden::request_handler<Log>
+  , holden::request_handler<Reject> {
+ public:
+  std::vector<int> lines;
+
+  long handle(const Multiply& r) { return r.a * r.b; }
+  void handle(const Log& r) { lines.push_back(r.line); }
+  int handle(const Reject&) { throw std::invalid_argument("rejected"); }
+};
+
+using bridge_t = holden::socket_bridge<Multiply, Log, Reject>;
+
+// Serves `remote` on one end of a socket pair; the other end feeds a bridge.
+struct Connection {
+  Remote remote;
+  int client_fd;
+  std::thread server;
+
+  Connection() {
+    int fds[2];
+    EXPECT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    client_fd = fds[0];
+    const int server_fd = fds[1];
+    server = std::thread([this, server_fd] {
+      auto m = holden::make_mediator(remote);
+      holden::serve_socket<Multiply, Log, Reject>(server_fd, m);
+      ::close(server_fd);
+    });
+  }
+};
+
+} // namespace
+
+TEST(socket_bridge, send_through_mediator) {
+  Connection c;
+  {
+    bridge_t bridge(c.client_fd);
+    auto m = holden::make_mediator(bridge);
+    ASSERT_EQ(42, m.send(Multiply{6, 7}));
+    m.send(Log{12});
+    ASSERT_THROW(m.send(Reject{}), holden::remote_handler_error);
+    ASSERT_EQ(-9, m.send(Multiply{3, -3}));
+  }
+  c.server.join();
+  ASSERT_EQ(std::vector<int>{12}, c.remote.lines);
+}
+
+TEST(socket_bridge, batch_coalesces_writes_and_pipelines) {
+  Connection c;
+  {
+    bridge_t bridge(c.client_fd);
+    std::vector<std::future<long>> responses;
+    {
+      bridge_t::batch b(bridge);
+      for (long i = 0; i < 500; ++i)
+        responses.push_back(bridge.send_async(Multiply{i, 2}));
+      bridge.send_async(Log{1});
+      ASSERT_EQ(0u, bridge.writes());
+    }
+    ASSERT_EQ(1u, bridge.writes());
+    for (long i = 0; i < 500; ++i)
+      ASSERT_EQ(i * 2, responses[std::size_t(i)].get());
+  }
+  c.server.join();
+}
+
+TEST(socket_bridge, batches_hold_back_only_their_own_thread) {
+  Connection c;
+  {
+    bridge_t bridge(c.client_fd);
+    bridge_t::batch b(bridge);
+    auto held_back = bridge.send_async(Multiply{2, 3});
+
+    // Another thread's request goes straight out.
+    std::thread([&] { ASSERT_EQ(20, bridge.handle(Multiply{4, 5})); }).join();
+    ASSERT_EQ(1u, bridge.writes());
+
+    // Waiting on a response from inside the batch writes it out first.
+    ASSERT_EQ(42, bridge.handle(Multiply{6, 7}));
+    ASSERT_EQ(2u, bridge.writes());
+    ASSERT_EQ(6, held_back.get());
+  }
+  c.server.join();
+}
+
+TEST(socket_bridge, concurrent_callers) {
+  Connection c;
+  {
+    bridge_t bridge(c.client_fd);
+    std::vector<std::thread> callers;
+    std::atomic<int> mismatches{0};
+    for (long t = 0; t < 4; ++t) {
+      callers.emplace_back([&, t] {
+        for (long i = 0; i < 200; ++i)
+          if (bridge.handle(Multiply{i, t}) != i * t) ++mismatches;
+      });
+    }
+    for (auto& caller : callers) caller.join();
+    ASSERT_EQ(0, mismatches.load());
+    ASSERT_LE(bridge.writes(), 800u);
+  }
+  c.server.join();
+}
+
+TEST(socket_bridge, lost_connection_fails_requests) {
+  int fds[2];
+  ASSERT_EQ(0, ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  bridge_t bridge(fds[0]);
+  auto pending = bridge.send_async(Multiply{1, 1});
+  ::close(fds[1]);
+  ASSERT_THROW(pending.get(), holden::remote_handler_error);
+  ASSERT_THROW(bridge.handle(Multiply{1, 1}), holden::remote_handler_error);
+}
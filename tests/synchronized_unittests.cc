@@ -0,0 +1,189 @@
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/fiber.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/synchronized.hpp"
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Factorial : holden::request<long> {
+  int n;
+  explicit Factorial(int _n) : n(_n) {}
+};
+
+struct Bump : holden::request<void> {};
+
+// Recurses through whatever mediator it is registered with.
+class Recursive
+  : holden::request_handler<Factorial>
+  , holden::request_handler<Bump> {
+ public:
+  std::function<long(int)> send_nested;
+  std::size_t deepest = 0;
+  long bumps = 0;
+
+  long handle(const Factorial& r) {
+    deepest = std::max(deepest, holden::this_thread_dispatch_depth());
+    return r.n <= 1 ? 1 : r.n * send_nested(r.n - 1);
+  }
+  void handle(const Bump&) { ++bumps; }
+};
+
+struct First : holden::request<int> {
+  bool nest;
+  explicit First(bool n) : nest(n) {}
+};
+struct Second : holden::request<int> {
+  bool nest;
+  explicit Second(bool n) : nest(n) {}
+};
+
+class FirstHandler : holden::request_handler<First> {
+ public:
+  std::function<int()> nested;
+  int handle(const First& r) { return r.nest ? nested() : 1; }
+};
+
+class SecondHandler : holden::request_handler<Second> {
+ public:
+  std::function<int()> nested;
+  int handle(const Second& r) { return r.nest ? nested() : 2; }
+};
+
+// Yields to other fibers halfway through, to catch a second caller inside.
+struct Enter : holden::request<int> {};
+
+class Exclusive : holden::request_handler<Enter> {
+ public:
+  int inside = 0;
+  int most_inside = 0;
+
+  int handle(const Enter&) {
+    most_inside = std::max(most_inside, ++inside);
+    holden::fiber_scheduler::current()->yield();
+    return inside--;
+  }
+};
+
+struct Descend : holden::request<void> {};
+
+// Each link sends on to the next one's mediator, holding its own lock.
+class Link : holden::request_handler<Descend> {
+ public:
+  std::function<void()> next;
+  void handle(const Descend&) { if (next) next(); }
+};
+
+std::vector<holden::lock_order_violation> g_violations;
+
+void record_violation(const holden::lock_order_violation& v) {
+  g_violations.push_back(v);
+}
+
+} // namespace
+
+TEST(synchronized, nested_send_runs_inline) {
+  Recursive handler{};
+  holden::synchronized<Recursive> locked(handler);
+  auto m = holden::make_mediator(locked);
+  handler.send_nested = [&](int n) { return m.send(Factorial{n}); };
+
+  ASSERT_EQ(3628800, m.send(Factorial{10}));
+  ASSERT_EQ(10u, handler.deepest);
+  ASSERT_EQ(0u, holden::this_thread_dispatch_depth());
+}
+
+TEST(synchronized, serialises_threads) {
+  Recursive handler{};
+  holden::synchronized<Recursive> locked(handler);
+  auto m = holden::make_mediator(locked);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 10000; ++i) m.send(Bump{});
+    });
+  }
+  for (auto& t : threads) t.join();
+  ASSERT_EQ(40000, handler.bumps);
+}
+
+TEST(synchronized, nested_send_on_dispatcher_worker_runs_inline) {
+  Recursive handler{};
+  auto m = holden::make_mediator(handler);
+  holden::dispatcher<decltype(m)> d(m);
+  handler.send_nested = [&](int n) {
+    EXPECT_TRUE(d.on_worker());
+    return n % 2 ? d.send(Factorial{n}) : d.send_async(Factorial{n}).get();
+  };
+
+  ASSERT_FALSE(d.on_worker());
+  ASSERT_EQ(720, d.send(Factorial{6}));
+  ASSERT_EQ(6u, handler.deepest);
+}
+
+TEST(synchronized, excludes_fibers_of_one_thread) {
+  Exclusive handler{};
+  holden::synchronized<Exclusive> locked(handler);
+  auto m = holden::make_mediator(locked);
+  holden::fiber_scheduler fibers;
+
+  auto first = fibers.send_async(m, Enter{});
+  auto second = fibers.send_async(m, Enter{});
+  ASSERT_EQ(1, first.get());
+  ASSERT_EQ(1, second.get());
+  ASSERT_EQ(1, handler.most_inside);
+  ASSERT_EQ(0u, holden::this_thread_dispatch_depth());
+}
+
+TEST(synchronized, too_many_nested_locks_is_an_error) {
+  using link_mediator = holden::mediator<holden::synchronized<Link>&>;
+  std::deque<Link> links(holden::detail::dispatch_state::max_held + 1);
+  std::deque<holden::synchronized<Link>> locked;
+  std::deque<link_mediator> mediators;
+  for (auto& link : links) {
+    locked.emplace_back(link);
+    mediators.emplace_back(locked.back());
+  }
+  for (std::size_t i = 0; i + 1 < links.size(); ++i)
+    links[i].next = [&mediators, i] { mediators[i + 1].send(Descend{}); };
+
+  ASSERT_THROW(mediators.front().send(Descend{}), std::length_error);
+  ASSERT_EQ(0u, holden::this_thread_dispatch_depth());
+
+  links[links.size() - 2].next = nullptr;
+  mediators.front().send(Descend{});
+}
+
+#if HOLDEN_MEDIATOR_LOCK_ORDER_CHECKS
+TEST(synchronized, reports_lock_order_cycles) {
+  FirstHandler first{};
+  SecondHandler second{};
+  holden::synchronized<FirstHandler> locked_first(first);
+  holden::synchronized<SecondHandler> locked_second(second);
+  auto m = holden::make_mediator(locked_first, locked_second);
+  first.nested = [&] { return m.send(Second{false}); };
+  second.nested = [&] { return m.send(First{false}); };
+
+  g_violations.clear();
+  auto previous = holden::set_lock_order_violation_handler(&record_violation);
+
+  ASSERT_EQ(2, m.send(First{true}));   // First, then Second
+  ASSERT_EQ(2, m.send(First{true}));
+  ASSERT_TRUE(g_violations.empty());
+
+  ASSERT_EQ(1, m.send(Second{true}));  // Second, then First: a cycle
+  holden::set_lock_order_violation_handler(previous);
+
+  ASSERT_EQ(1u, g_violations.size());
+  ASSERT_NE(nullptr, std::strstr(g_violations[0].acquiring, "FirstHandler"));
+  ASSERT_NE(nullptr, std::strstr(g_violations[0].held, "SecondHandler"));
+}
+#endif
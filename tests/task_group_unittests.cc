@@ -0,0 +1,132 @@
+#include "../include/cpp_mediator/dispatcher.hpp"
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/task_group.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+namespace {
+
+struct Shard : holden::request<long> {
+  long id;
+  explicit Shard(long i) : id(i) {}
+};
+
+struct Hold : holden::request<void> {
+  std::shared_future<void> release;
+  explicit Hold(std::shared_future<void> r) : release(std::move(r)) {}
+};
+
+class Store
+  : holden::request_handler<Shard>
+  , holden::request_handler<Hold> {
+ public:
+  std::atomic<int> handled{0};
+  long handle(const Shard& r) { ++handled; return r.id * r.id; }
+  void handle(const Hold& r) { r.release.wait(); }
+};
+
+// Counts live instances; a moved-from one no longer counts. Dying takes a
+// while, so one destroyed late is still counted when the test checks.
+class Tracked {
+  std::atomic<int>* live_;
+
+ public:
+  explicit Tracked(std::atomic<int>& live) : live_(&live) { ++live; }
+  Tracked(Tracked&& other) : live_(other.live_) { other.live_ = nullptr; }
+  Tracked(const Tracked& other) : live_(other.live_) {
+    if (live_) ++*live_;
+  }
+  Tracked& operator=(const Tracked&) = delete;
+  ~Tracked() {
+    if (!live_) return;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    --*live_;
+  }
+};
+
+} // namespace
+
+TEST(task_group, waits_for_all_children) {
+  Store store{};
+  auto m = holden::make_mediator(store);
+  holden::dispatcher<decltype(m)> d(m);
+
+  long sum = 0;
+  {
+    holden::task_group<decltype(d)> group(d);
+    for (long i = 1; i <= 100; ++i)
+      group.spawn(Shard{i}, [&](holden::result<long> r) { sum += r.value(); });
+    group.wait();
+    ASSERT_EQ(0u, group.pending());
+    ASSERT_EQ(338350, sum);
+
+    // Reusable after a wait.
+    group.spawn(Shard{2}, [&](holden::result<long> r) { sum += r.value(); });
+  }
+  ASSERT_EQ(338354, sum);
+}
+
+TEST(task_group, cancel_skips_unstarted_children) {
+  Store store{};
+  auto m = holden::make_mediator(store);
+  holden::dispatcher<decltype(m)> d(m);
+
+  std::promise<void> release;
+  holden::task_group<decltype(d)> group(d);
+  group.spawn(Hold{release.get_future().share()});
+
+  std::atomic<int> cancelled{0};
+  for (long i = 0; i < 10; ++i) {
+    group.spawn(Shard{i}, [&](holden::result<long> r) {
+      try {
+        r.value();
+      } catch (const holden::task_cancelled&) {
+        ++cancelled;
+      }
+    });
+  }
+  group.cancel();
+  release.set_value();
+  group.wait();
+
+  ASSERT_TRUE(group.cancelled());
+  ASSERT_EQ(10, cancelled.load());
+  ASSERT_EQ(0, store.handled.load());
+}
+
+TEST(task_group, destructor_joins_children) {
+  Store store{};
+  auto m = holden::make_mediator(store);
+  holden::dispatcher<decltype(m)> d(m);
+
+  std::promise<void> release;
+  std::atomic<bool> finished{false};
+  std::thread releaser([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    release.set_value();
+  });
+  {
+    holden::task_group<decltype(d)> group(d);
+    group.spawn(Hold{release.get_future().share()},
+                [&](holden::result<void>) { finished = true; });
+  }
+  ASSERT_TRUE(finished.load());
+  releaser.join();
+}
+
+TEST(task_group, continuations_are_destroyed_before_wait_returns) {
+  Store store{};
+  auto m = holden::make_mediator(store);
+  holden::dispatcher<decltype(m)> d(m);
+
+  std::atomic<int> live{0};
+  holden::task_group<decltype(d)> group(d);
+  for (long i = 0; i < 3; ++i)
+    group.spawn(Shard{i}, [t = Tracked(live)](holden::result<long>) {});
+  group.wait();
+  ASSERT_EQ(0, live.load());
+}
@@ -0,0 +1,155 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/thread_local_handler.hpp"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Format : holden::request<std::string> {
+  int value;
+  explicit Format(int v) : value(v) {}
+};
+
+class Formatter : holden::request_handler<Format> {
+ public:
+  std::string prefix;
+  std::string scratch;
+  int formatted = 0;
+
+  explicit Formatter(std::string p = "") : prefix(std::move(p)) {}
+
+  std::string handle(const Format& f) {
+    ++formatted;
+    scratch = prefix + std::to_string(f.value);
+    return scratch;
+  }
+};
+
+} // namespace
+
+TEST(thread_local_handler, one_instance_per_thread) {
+  holden::thread_local_handler<Formatter> formatters(Formatter("#"));
+  auto m = holden::make_mediator(formatters);
+
+  ASSERT_EQ("#1", m.send(Format{1}));
+  ASSERT_EQ(1u, formatters.instance_count());
+
+  std::atomic<int> ready{0};
+  std::atomic<bool> done{false};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 100; ++i) m.send(Format{i});
+      ++ready;
+      while (!done) std::this_thread::yield();
+    });
+  }
+  while (ready < 4) std::this_thread::yield();
+
+  ASSERT_EQ(5u, formatters.instance_count());
+  int total = 0;
+  formatters.for_each([&](Formatter& f) {
+    ASSERT_EQ("#", f.prefix);
+    total += f.formatted;
+  });
+  ASSERT_EQ(401, total);
+
+  done = true;
+  for (auto& t : threads) t.join();
+  ASSERT_EQ(1u, formatters.instance_count());
+  ASSERT_EQ(1, formatters.local().formatted);
+}
+
+TEST(thread_local_handler, merges_periodically_and_on_thread_exit) {
+  std::atomic<int> merged{0};
+  std::atomic<int> merges{0};
+  holden::thread_local_handler<Formatter> formatters(
+      Formatter(), 10, [&](Formatter& f) {
+        merged += f.formatted;
+        f.formatted = 0;
+        ++merges;
+      });
+  auto m = holden::make_mediator(formatters);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 3; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 25; ++i) m.send(Format{i});
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  // Each thread merged after its 10th and 20th sends, then as it exited.
+  ASSERT_EQ(9, merges.load());
+  ASSERT_EQ(75, merged.load());
+  ASSERT_EQ(0u, formatters.instance_count());
+}
+
+TEST(thread_local_handler, merges_what_is_left_when_destroyed) {
+  int merged = 0;
+  {
+    holden::thread_local_handler<Formatter> formatters(
+        Formatter(), 10, [&](Formatter& f) {
+          merged += f.formatted;
+          f.formatted = 0;
+        });
+    auto m = holden::make_mediator(formatters);
+    for (int i = 0; i < 25; ++i) m.send(Format{i});
+    ASSERT_EQ(20, merged);
+  }
+  ASSERT_EQ(25, merged);
+}
+
+TEST(thread_local_handler, merge_every_without_merge_is_ignored) {
+  holden::thread_local_handler<Formatter> formatters(Formatter(), 10);
+  auto m = holden::make_mediator(formatters);
+  for (int i = 0; i < 25; ++i) m.send(Format{i});
+  ASSERT_EQ(25, formatters.local().formatted);
+}
+
+TEST(thread_local_handler, exit_merge_may_use_other_per_thread_state) {
+  // The exit merge runs without the registry's lock, so it may create
+  // per-thread tables and bind values in them.
+  std::atomic<std::size_t> scratch_instances{0};
+  holden::thread_local_handler<Formatter> formatters(
+      Formatter(), 0, [&](Formatter&) {
+        holden::thread_local_handler<Formatter> scratch;
+        scratch.local();
+        scratch_instances = scratch.instance_count();
+      });
+  auto m = holden::make_mediator(formatters);
+
+  std::thread([&] { m.send(Format{1}); }).join();
+  ASSERT_EQ(1u, scratch_instances.load());
+  ASSERT_EQ(0u, formatters.instance_count());
+}
+
+TEST(thread_local_handler, reuses_storage_across_slots_and_threads) {
+  // Scoped slots and short-lived threads leave nothing behind.
+  const auto& bindings = holden::detail::per_thread_registry::thread_bindings();
+  std::size_t first_round_bindings = 0;
+  for (int round = 0; round < 100; ++round) {
+    holden::thread_local_handler<Formatter> formatters;
+    auto m = holden::make_mediator(formatters);
+    m.send(Format{round});
+    std::thread([&] { m.send(Format{round}); }).join();
+    ASSERT_EQ(1u, formatters.instance_count());
+    if (round == 0) first_round_bindings = bindings.size();
+  }
+  ASSERT_EQ(first_round_bindings, bindings.size());
+}
+
+TEST(thread_local_handler, slots_do_not_share_instances) {
+  holden::thread_local_handler<Formatter> a(Formatter("a"));
+  holden::thread_local_handler<Formatter> b(Formatter("b"));
+  auto ma = holden::make_mediator(a);
+  auto mb = holden::make_mediator(b);
+  ASSERT_EQ("a1", ma.send(Format{1}));
+  ASSERT_EQ("b2", mb.send(Format{2}));
+  ASSERT_NE(&a.local(), &b.local());
+}
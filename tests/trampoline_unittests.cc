@@ -0,0 +1,92 @@
+#include "../include/cpp_mediator/mediator.hpp"
+#include "../include/cpp_mediator/trampoline.hpp"
+#include <gtest/gtest.h>
+
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include <pthread.h>
+
+namespace {
+
+struct Step : holden::request<void> {
+  long remaining;
+  explicit Step(long r) : remaining(r) {}
+};
+
+struct Fork : holden::request<void> {
+  int id;
+  explicit Fork(int i) : id(i) {}
+};
+
+class Chain
+  : holden::request_handler<Step>
+  , holden::request_handler<Fork> {
+ public:
+  std::function<void(long)> next;
+  std::function<void(int)> fork;
+  long steps = 0;
+  std::vector<int> order;
+
+  void handle(const Step& s) {
+    ++steps;
+    if (s.remaining > 0) next(s.remaining - 1);
+  }
+  void handle(const Fork& f) {
+    order.push_back(f.id);
+    if (f.id == 3) throw std::runtime_error("stop");
+    if (f.id < 2) {
+      fork(f.id * 2 + 2);
+      fork(f.id * 2 + 3);
+    }
+  }
+};
+
+struct ChainRun {
+  long length;
+  long steps;
+};
+
+void* run_chain(void* arg) {
+  auto* run = static_cast<ChainRun*>(arg);
+  Chain chain{};
+  auto m = holden::make_mediator(chain);
+  chain.next = [&](long remaining) { holden::send_tail(m, Step{remaining}); };
+  // A plain send from outside: the first tail call inside becomes the
+  // trampoline.
+  m.send(Step{run->length});
+  run->steps = chain.steps;
+  return nullptr;
+}
+
+} // namespace
+
+TEST(trampoline, million_step_chain_on_64k_stack) {
+  ChainRun run{1000000, 0};
+
+  pthread_attr_t attr;
+  ASSERT_EQ(0, pthread_attr_init(&attr));
+  ASSERT_EQ(0, pthread_attr_setstacksize(&attr, 64 * 1024));
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, &attr, &run_chain, &run));
+  ASSERT_EQ(0, pthread_join(thread, nullptr));
+  pthread_attr_destroy(&attr);
+
+  ASSERT_EQ(1000001, run.steps);
+}
+
+TEST(trampoline, runs_tail_calls_in_order_and_stops_on_exception) {
+  Chain chain{};
+  auto m = holden::make_mediator(chain);
+  chain.fork = [&](int id) { holden::send_tail(m, Fork{id}); };
+
+  ASSERT_THROW(holden::send_tail(m, Fork{0}), std::runtime_error);
+  // 0 queues 2 and 3; 2 is not < 2 so queues nothing; 3 throws.
+  ASSERT_EQ((std::vector<int>{0, 2, 3}), chain.order);
+
+  // The thread's trampoline is usable again afterwards.
+  chain.order.clear();
+  holden::send_tail(m, Fork{1});
+  ASSERT_EQ((std::vector<int>{1, 4, 5}), chain.order);
+}